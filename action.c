@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "action.h"
+#include "cards.h"
+
+/* The list always counts every action, it only stops writing them once it is
+ * full */
+static void add_action(uint32_t *actions, int max_actions, int *num_actions,
+                       uint32_t action)
+{
+    if (*num_actions < max_actions) {
+        actions[*num_actions] = action;
+    }
+    (*num_actions)++;
+}
+
+/* Steps v through every vector with v[i] <= cap[i] that adds up to sum, from
+ * the one with everything packed to the left onwards. Returns false once they
+ * have all been seen */
+static bool next_composition(uint8_t *v, const uint8_t *cap, int n, int sum,
+                             bool first)
+{
+    int carry = 0;
+    int room = 0;
+    int i, j;
+
+    if (first) {
+        i = -1;
+        carry = sum;
+    } else {
+        /* Find the last unit that can still move right */
+        for (i = n - 1; i >= 0; i--) {
+            if (v[i] > 0 && room > 0) {
+                break;
+            }
+            room += cap[i] - v[i];
+            carry += v[i];
+        }
+        if (i < 0) {
+            return false;
+        }
+        v[i]--;
+        carry++;
+    }
+
+    for (j = i + 1; j < n; j++) {
+        v[j] = min(cap[j], carry);
+        carry -= v[j];
+    }
+
+    return carry == 0;
+}
+
+static bool next_added(struct fleet_iter *iter, bool first)
+{
+    return next_composition(iter->added, iter->add_cap, FRIGATE_SLOTS,
+                            iter->moved, first);
+}
+
+/* Picks the next set of slots to take frigates from and clears out where
+ * they're allowed to go */
+static bool next_removed(struct fleet_iter *iter, bool first)
+{
+    int slot;
+
+    while (!next_composition(iter->removed, iter->start, FRIGATE_SLOTS,
+                             iter->moved, first)) {
+        if (iter->moved == iter->max_moves) {
+            return false;
+        }
+        iter->moved++;
+        first = true;
+    }
+
+    for (slot = 0; slot < FRIGATE_SLOTS; slot++) {
+        iter->add_cap[slot] = iter->removed[slot] ? 0 : iter->moved;
+    }
+
+    return true;
+}
+
+void fleet_iter_init(struct fleet_iter *iter, struct game_state *game,
+                     int max_moves)
+{
+    int slot;
+    int total = 0;
+
+    memset(iter, 0, sizeof(*iter));
+    for (slot = 0; slot < FRIGATE_SLOTS; slot++) {
+        iter->start[slot] = *slot_frigates(game, slot);
+        total += iter->start[slot];
+    }
+    iter->max_moves = min(max_moves, total);
+}
+
+/* Fills in moves that reach the next layout, the first one is leaving every
+ * frigate where it is. Returns false once every layout has been seen */
+bool fleet_iter_next(struct fleet_iter *iter, struct frigate_move *moves,
+                     int *num_moves)
+{
+    uint8_t removed[FRIGATE_SLOTS];
+    uint8_t added[FRIGATE_SLOTS];
+    int from = 0;
+    int to = 0;
+    int quantity;
+
+    if (!iter->started) {
+        iter->started = true;
+        next_removed(iter, true);
+        next_added(iter, true);
+    } else if (!next_added(iter, false)) {
+        /* There's always somewhere to put them, every slot that loses a
+         * frigate leaves at least one other to add to */
+        do {
+            if (!next_removed(iter, false)) {
+                return false;
+            }
+        } while (!next_added(iter, true));
+    }
+
+    /* Pair up what's taken with what's added in slot order */
+    memcpy(removed, iter->removed, sizeof(removed));
+    memcpy(added, iter->added, sizeof(added));
+    *num_moves = 0;
+    while (true) {
+        while (from < FRIGATE_SLOTS && removed[from] == 0) {
+            from++;
+        }
+        while (to < FRIGATE_SLOTS && added[to] == 0) {
+            to++;
+        }
+        if (from == FRIGATE_SLOTS || to == FRIGATE_SLOTS) {
+            break;
+        }
+
+        quantity = min(removed[from], added[to]);
+        removed[from] -= quantity;
+        added[to] -= quantity;
+
+        moves[*num_moves].from = slot_location(from);
+        moves[*num_moves].from_zone = slot_zone(from);
+        moves[*num_moves].to = slot_location(to);
+        moves[*num_moves].to_zone = slot_zone(to);
+        moves[*num_moves].quantity = quantity;
+        (*num_moves)++;
+    }
+
+    return true;
+}
+
+/* The action once for every fleet layout that moving up to max_moves
+ * frigates can reach, starting with moving none */
+static void add_move_actions(struct game_state *game, uint32_t base,
+                             int max_moves, uint32_t *actions,
+                             int max_actions, int *num_actions)
+{
+    struct fleet_iter iter;
+    struct frigate_move moves[ACTION_MAX_MOVES];
+    int num_moves;
+    uint32_t action;
+    int from;
+    int to;
+    int i, j;
+
+    assert(max_moves <= ACTION_MAX_MOVES);
+
+    fleet_iter_init(&iter, game, max_moves);
+    while (fleet_iter_next(&iter, moves, &num_moves)) {
+        action = base;
+        for (i = 0; i < num_moves; i++) {
+            from = frigate_slot(moves[i].from, moves[i].from_zone);
+            to = frigate_slot(moves[i].to, moves[i].to_zone);
+            for (j = 0; j < moves[i].quantity; j++) {
+                action = action_add_move(action, from, to);
+            }
+        }
+        add_action(actions, max_actions, num_actions, action);
+    }
+}
+
+/* The card the action plays if its event only moves frigates, NULL for any
+ * other action */
+static struct card *moves_card(struct game_state *game, uint32_t action)
+{
+    int idx = action_idx(action);
+    struct card *card = NULL;
+
+    if (action_type(action) == US_PLAY_CARD && idx < hand_size(game)) {
+        card = hand_card(game, idx);
+    } else if (action_type(action) == US_PLAY_CORE) {
+        card = core_card(game, idx);
+    }
+
+    if (card == NULL || card->frigate_moves == 0) {
+        return NULL;
+    }
+    return card;
+}
+
+/* Copies of a card that only moves frigates play out the same, only the
+ * first one in the hand is worth listing */
+static bool moves_card_listed(struct game_state *game, int idx)
+{
+    int i;
+
+    for (i = 0; i < idx; i++) {
+        if (hand_card(game, i) == hand_card(game, idx)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Lists every legal way to take the US turn into actions and returns how many
+ * there are, which is more than max_actions if they didn't all fit. Passing is
+ * only legal when there's nothing else to do.
+ *
+ * Search tries actions in list order, so everything that is a single action
+ * comes first and the hundreds of ways to move frigates can't keep any card
+ * from being tried */
+int legal_actions(struct game_state *game, uint32_t *actions, int max_actions)
+{
+    struct card *card;
+    int num_actions = 0;
+    int moves_start = -1;
+    int num_moves = 0;
+    int i, j;
+
+    assert(game->phase == PHASE_US_TURN);
+    assert(hand_size(game) <= MAX_HAND_SIZE);
+
+    /* Partway through a card's moves, the only choice is where the next ones
+     * go */
+    if (game->us_moves_left > 0) {
+        add_move_actions(game, action_make(US_MOVE_FRIGATES, 0),
+                         min(game->us_moves_left, ACTION_MAX_MOVES), actions,
+                         max_actions, &num_actions);
+        return num_actions;
+    }
+
+    for (i = 0; i < hand_size(game); i++) {
+        if (hand_card_playable(game, i) &&
+            hand_card(game, i)->frigate_moves == 0) {
+            add_action(actions, max_actions, &num_actions,
+                       action_make(US_PLAY_CARD, i));
+        }
+        if (game->us_gunboats < MAX_GUNBOATS) {
+            add_action(actions, max_actions, &num_actions,
+                       action_make(US_BUILD_GUNBOAT, i));
+        }
+    }
+
+    for (i = 0; i < mask_count(game->us_core); i++) {
+        if (core_card_playable(game, i) &&
+            core_card(game, i)->frigate_moves == 0) {
+            add_action(actions, max_actions, &num_actions,
+                       action_make(US_PLAY_CORE, i));
+        }
+    }
+
+    /* Thomas Jefferson and Naval Movement with their first moves */
+    for (i = 0; i < mask_count(game->us_core); i++) {
+        card = core_card(game, i);
+        if (core_card_playable(game, i) && card->frigate_moves > 0) {
+            add_move_actions(game, action_make(US_PLAY_CORE, i),
+                             min(card->frigate_moves, ACTION_MAX_MOVES),
+                             actions, max_actions, &num_actions);
+        }
+    }
+    for (i = 0; i < hand_size(game); i++) {
+        card = hand_card(game, i);
+        if (hand_card_playable(game, i) && card->frigate_moves > 0 &&
+            !moves_card_listed(game, i)) {
+            add_move_actions(game, action_make(US_PLAY_CARD, i),
+                             min(card->frigate_moves, ACTION_MAX_MOVES),
+                             actions, max_actions, &num_actions);
+        }
+    }
+
+    for (i = 0; i < hand_size(game); i++) {
+        /* Every card moves the same frigates, copy the first card's moves if
+         * they all fit */
+        if (moves_start >= 0 && moves_start + num_moves <= max_actions) {
+            for (j = 0; j < num_moves; j++) {
+                add_action(actions, max_actions, &num_actions,
+                           action_make(US_MOVE_FRIGATES, i) |
+                           (actions[moves_start + j] & ~(uint32_t)0xff));
+            }
+        } else {
+            moves_start = num_actions;
+            add_move_actions(game, action_make(US_MOVE_FRIGATES, i),
+                             ACTION_MAX_MOVES, actions, max_actions,
+                             &num_actions);
+            num_moves = num_actions - moves_start;
+        }
+    }
+
+    if (num_actions == 0) {
+        add_action(actions, max_actions, &num_actions,
+                   action_make(US_PASS, 0));
+    }
+
+    return num_actions;
+}
+
+/* Takes the US turn like answering take_turn would and moves the game on to
+ * the battles, unless a card has frigates left to move. Any decisions inside
+ * a played card still go to game->player, other than the moves of a card
+ * that only moves frigates */
+const char *apply_action(struct game_state *game, uint32_t action)
+{
+    struct frigate_move moves[ACTION_MAX_MOVES];
+    struct card *card = moves_card(game, action);
+    int num_moves = action_moves(action, moves);
+    int moves_left = 0;
+    int idx = action_idx(action);
+    const char *err;
+
+    assert(game->phase == PHASE_US_TURN);
+
+    if (game->us_moves_left > 0) {
+        if (action_type(action) != US_MOVE_FRIGATES) {
+            return "Finish moving the card's frigates first";
+        }
+        err = validate_moves(game, moves, num_moves, game->us_moves_left);
+        if (err == NULL) {
+            move_frigates(game, moves, num_moves);
+            moves_left = game->us_moves_left - num_moves;
+        }
+    } else if (card != NULL) {
+        err = play_card_moves(game, action_type(action), idx, moves,
+                              num_moves);
+        moves_left = card->frigate_moves - num_moves;
+    } else if (action_type(action) != US_MOVE_FRIGATES) {
+        err = game_take_action(game, action_type(action), idx);
+    } else if (idx >= hand_size(game)) {
+        err = "Invalid card index";
+    } else {
+        err = validate_moves(game, moves, num_moves, ACTION_MAX_MOVES);
+        if (err == NULL) {
+            move_frigates(game, moves, num_moves);
+            discard_from_hand(game, idx);
+        }
+    }
+
+    if (err != NULL) {
+        return err;
+    }
+
+    /* Stopping short of a full action's moves is the end of the card */
+    if (num_moves < ACTION_MAX_MOVES) {
+        moves_left = 0;
+    }
+    game_set(game, game->us_moves_left, moves_left);
+    if (moves_left == 0) {
+        game_set(game, game->phase, PHASE_BATTLES);
+    }
+    return NULL;
+}
+
+/* Describes the action the way the player would enter it at the prompt */
+void action_str(struct game_state *game, uint32_t action, char *buf,
+                size_t size)
+{
+    struct frigate_move moves[ACTION_MAX_MOVES];
+    int num_moves;
+    int idx = action_idx(action);
+    int len;
+    int i;
+
+    switch (action_type(action)) {
+        case US_PASS:
+            snprintf(buf, size, "pass");
+            return;
+        case US_PLAY_CARD:
+            len = snprintf(buf, size, "play %d (%s)", idx,
+                           hand_card(game, idx)->name);
+            break;
+        case US_PLAY_CORE:
+            len = snprintf(buf, size, "core %d (%s)", idx,
+                           core_card(game, idx)->name);
+            break;
+        case US_BUILD_GUNBOAT:
+            snprintf(buf, size, "discard %d gunboat (%s)", idx,
+                     hand_card(game, idx)->name);
+            return;
+        case US_MOVE_FRIGATES:
+            if (game->us_moves_left > 0) {
+                len = snprintf(buf, size, "%s",
+                               (action_num_moves(action) > 0) ?
+                               "keep moving" : "stop moving");
+            } else {
+                len = snprintf(buf, size, "discard %d move (%s)", idx,
+                               hand_card(game, idx)->name);
+            }
+            break;
+        default:
+            assert(false);
+            return;
+    }
+
+    num_moves = action_moves(action, moves);
+    for (i = 0; i < num_moves && len < size; i++) {
+        len += snprintf(buf + len, size - len, "%s%s %s -> %s %s",
+                        i ? ", " : ": ", location_str(moves[i].from),
+                        zone_str(moves[i].from_zone),
+                        location_str(moves[i].to), zone_str(moves[i].to_zone));
+    }
+}
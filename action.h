@@ -0,0 +1,104 @@
+#ifndef ACTION_H
+#define ACTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/* A whole US turn packed into an integer so search can list and replay turns
+ * without going through the text commands:
+ *
+ * bits 0-2   enum us_action
+ * bits 3-7   hand or core card index
+ * bits 8-9   number of frigates moved when discarding to move or playing a
+ *            card that only moves frigates (struct card frigate_moves)
+ * bits 10-25 up to two single frigate moves, 4 bits each for the from and to
+ *            frigate slot, see FRIGATE_SLOTS
+ *
+ * A card that moves more frigates than that moves them two at a time. When
+ * its first two moves are used the turn stays open with game->us_moves_left
+ * set, and every action until it runs out is US_MOVE_FRIGATES with the next
+ * moves and no card. Moving nothing, or fewer than two, ends the card
+ */
+#define ACTION_MAX_MOVES (2)
+
+static inline uint32_t action_make(enum us_action type, int idx)
+{
+    return type | (uint32_t)idx << 3;
+}
+
+static inline enum us_action action_type(uint32_t action)
+{
+    return action & 0x7;
+}
+
+static inline int action_idx(uint32_t action)
+{
+    return (action >> 3) & 0x1f;
+}
+
+static inline int action_num_moves(uint32_t action)
+{
+    return (action >> 8) & 0x3;
+}
+
+static inline uint32_t action_add_move(uint32_t action, int from_slot,
+                                       int to_slot)
+{
+    int shift = 10 + action_num_moves(action) * 8;
+
+    assert(action_num_moves(action) < ACTION_MAX_MOVES);
+
+    return (action + (1 << 8)) | (uint32_t)from_slot << shift |
+        (uint32_t)to_slot << (shift + 4);
+}
+
+/* Fills in the frigate moves of the action and returns how many there are */
+static inline int action_moves(uint32_t action, struct frigate_move *moves)
+{
+    int i;
+    int shift;
+
+    for (i = 0; i < action_num_moves(action); i++) {
+        shift = 10 + i * 8;
+        moves[i].from = slot_location((action >> shift) & 0xf);
+        moves[i].from_zone = slot_zone((action >> shift) & 0xf);
+        moves[i].to = slot_location((action >> (shift + 4)) & 0xf);
+        moves[i].to_zone = slot_zone((action >> (shift + 4)) & 0xf);
+        moves[i].quantity = 1;
+    }
+
+    return action_num_moves(action);
+}
+
+/* Walks every distinct fleet layout reachable by moving up to max_moves
+ * frigates, each exactly once. A layout is the frigates taken out of some
+ * slots and put into others, never both for the same slot, so no two
+ * different move lists that end the same way are ever both listed. Search
+ * walks it ACTION_MAX_MOVES at a time, also for Thomas Jefferson and Naval
+ * Movement, whose every layout at once would be far too many actions */
+struct fleet_iter {
+    uint8_t start[FRIGATE_SLOTS];
+    /* Frigates taken from each slot and added to each slot */
+    uint8_t removed[FRIGATE_SLOTS];
+    uint8_t added[FRIGATE_SLOTS];
+    /* Room left to add to, 0 for slots that frigates are taken from */
+    uint8_t add_cap[FRIGATE_SLOTS];
+    int max_moves;
+    /* Frigates moved in the current layout */
+    int moved;
+    bool started;
+};
+
+void fleet_iter_init(struct fleet_iter *iter, struct game_state *game,
+                     int max_moves);
+bool fleet_iter_next(struct fleet_iter *iter, struct frigate_move *moves,
+                     int *num_moves);
+
+int legal_actions(struct game_state *game, uint32_t *actions, int max_actions);
+const char *apply_action(struct game_state *game, uint32_t action);
+void action_str(struct game_state *game, uint32_t action, char *buf,
+                size_t size);
+
+#endif /* ACTION_H */
@@ -0,0 +1,912 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if !defined(__MINGW32__)
+#include <sys/mman.h>
+#else
+#include <io.h>
+#endif /* !defined(__MINGW32__) */
+
+#include "assault.h"
+#include "cards.h"
+#include "odds.h"
+#include "tbot.h"
+
+#define ASSAULT_MAX_BOMBARD_DICE (ASSAULT_MAX_FRIGATES * FRIGATE_DICE + \
+                                  MAX_GUNBOATS)
+
+/* Chance the US wins the ground combat at Tripoli once the bombardment is
+ * over, ground[lieutenant][sharpshooters][marines][arabs][t_infantry] */
+static double ground[2][2][ASSAULT_MAX_MARINES + 1][ASSAULT_MAX_ARABS + 1]
+    [ASSAULT_MAX_T_INFANTRY + 1];
+static pthread_once_t ground_once = PTHREAD_ONCE_INIT;
+
+/* The naval battle with the ground forces fixed, only one set of ground forces
+ * is kept at a time. values[frigates][damaged_frigates][gunboats][losses_left]
+ * [t_frigates][t_damaged_frigates][t_corsairs], negative until solved */
+#define NAVAL_STATES ((ASSAULT_MAX_FRIGATES + 1) * (ASSAULT_MAX_FRIGATES + 1) * \
+                      (MAX_GUNBOATS + 1) * (DESTROYED_FRIGATES_WIN + 1) *      \
+                      (ASSAULT_MAX_T_FRIGATES + 1) *                           \
+                      (ASSAULT_MAX_T_FRIGATES + 1) * (MAX_TRIPOLI_CORSAIRS + 1))
+
+struct naval_solve {
+    /* The ground forces the table was solved for */
+    struct assault_state ground;
+    bool valid;
+    /* Win chance after the naval battle by dice in the bombardment, 0 when
+     * there are no frigates left to bombard with */
+    double after[ASSAULT_MAX_BOMBARD_DICE + 1];
+    double values[NAVAL_STATES];
+};
+
+/* Shared by every call to assault_win_chance() */
+static struct naval_solve naval;
+static pthread_mutex_t naval_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Solved starts of the assault, nothing damaged yet, written once by
+ * assault_write_tablebase() and mapped read only by every thread. Win chances
+ * are stored in 1/65535ths, indexed by tablebase_index() */
+#define TABLEBASE_MAGIC "SOTASLT"
+#define TABLEBASE_VERSION (1)
+#define TABLEBASE_MAX_FRIGATES (8)
+#define TABLEBASE_MAX_MARINES (4)
+#define TABLEBASE_MAX_ARABS (7)
+#define TABLEBASE_MAX_T_INFANTRY (8)
+#define TABLEBASE_SCALE (65535)
+
+enum tablebase_dim {
+    TB_LIEUTENANT,
+    TB_SHARPSHOOTERS,
+    TB_T_INFANTRY,
+    TB_MARINES,
+    TB_ARABS,
+    TB_GUNS_OF_TRIPOLI,
+    TB_PREBLES_BOYS,
+    TB_FRIGATES,
+    TB_GUNBOATS,
+    TB_LOSSES_LEFT,
+    TB_T_FRIGATES,
+    TB_T_CORSAIRS,
+    TB_DIMS
+};
+
+/* Values each dimension takes, losses_left counts from 1 */
+static const uint8_t tablebase_dims[TB_DIMS] = {
+    [TB_LIEUTENANT] = 2,
+    [TB_SHARPSHOOTERS] = 2,
+    [TB_T_INFANTRY] = TABLEBASE_MAX_T_INFANTRY + 1,
+    [TB_MARINES] = TABLEBASE_MAX_MARINES + 1,
+    [TB_ARABS] = TABLEBASE_MAX_ARABS + 1,
+    [TB_GUNS_OF_TRIPOLI] = 2,
+    [TB_PREBLES_BOYS] = 2,
+    [TB_FRIGATES] = TABLEBASE_MAX_FRIGATES + 1,
+    [TB_GUNBOATS] = MAX_GUNBOATS + 1,
+    [TB_LOSSES_LEFT] = DESTROYED_FRIGATES_WIN,
+    [TB_T_FRIGATES] = ASSAULT_MAX_T_FRIGATES + 1,
+    [TB_T_CORSAIRS] = MAX_TRIPOLI_CORSAIRS + 1,
+};
+
+struct tablebase_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t entries;
+    /* A build with other limits can't read the file */
+    uint8_t dims[TB_DIMS];
+    uint8_t pad[4];
+    /* Of the values that follow the header */
+    uint64_t checksum;
+};
+
+static struct {
+    const struct tablebase_header *header;
+    const uint16_t *values;
+    size_t bytes;
+} tablebase;
+
+/* The US side of the naval battle, the only part a round's damage changes */
+struct us_fleet {
+    int frigates;
+    int damaged;
+    int gunboats;
+    int losses_left;
+};
+
+struct t_fleet {
+    int frigates;
+    int damaged;
+    int corsairs;
+};
+
+static double ground_chance(bool lieutenant, bool sharpshooters, int marines,
+                            int arabs, int t_infantry)
+{
+    return ground[lieutenant][sharpshooters][marines][arabs][t_infantry];
+}
+
+/* One round of resolve_ground_combat() and everything after it. The US takes
+ * its losses whichever way wins most often */
+static double solve_ground(bool lieutenant, bool sharpshooters, int marines,
+                           int arabs, int t_infantry)
+{
+    struct odds_dist us_hits;
+    struct odds_dist arab_hits;
+    struct odds_dist t_hits;
+    double p;
+    double p_same = 0;
+    double value = 0;
+    double best;
+    int killed, lost, m;
+
+    if (t_infantry == 0) {
+        return 1;
+    }
+    if (marines + arabs == 0) {
+        return 0;
+    }
+
+    odds_roll(marines + ((lieutenant && marines > 0) ? 2 : 0),
+              (sharpshooters) ? 5 : 6, &us_hits);
+    odds_roll(arabs, 6, &arab_hits);
+    odds_add(&us_hits, &arab_hits, &us_hits);
+    odds_cap(&us_hits, t_infantry);
+    odds_roll(t_infantry, 6, &t_hits);
+    odds_cap(&t_hits, marines + arabs);
+
+    for (killed = 0; killed <= us_hits.max; killed++) {
+        for (lost = 0; lost <= t_hits.max; lost++) {
+            p = us_hits.p[killed] * t_hits.p[lost];
+            if (killed == 0 && lost == 0) {
+                /* Nothing changed, the round is fought again */
+                p_same += p;
+                continue;
+            }
+
+            best = 0;
+            for (m = (lost > arabs) ? lost - arabs : 0;
+                 m <= lost && m <= marines; m++) {
+                best = fmax(best, ground_chance(lieutenant, sharpshooters,
+                                                marines - m,
+                                                arabs - (lost - m),
+                                                t_infantry - killed));
+            }
+            value += p * best;
+        }
+    }
+
+    return value / (1 - p_same);
+}
+
+/* Every round only ever takes units away, so solving from the smallest forces
+ * up always finds the next round already solved */
+static void solve_ground_table(void)
+{
+    int lieutenant, sharpshooters, marines, arabs, t_infantry;
+
+    for (lieutenant = 0; lieutenant < 2; lieutenant++) {
+        for (sharpshooters = 0; sharpshooters < 2; sharpshooters++) {
+            for (marines = 0; marines <= ASSAULT_MAX_MARINES; marines++) {
+                for (arabs = 0; arabs <= ASSAULT_MAX_ARABS; arabs++) {
+                    for (t_infantry = 0; t_infantry <= ASSAULT_MAX_T_INFANTRY;
+                         t_infantry++) {
+                        ground[lieutenant][sharpshooters][marines][arabs]
+                            [t_infantry] = solve_ground(lieutenant,
+                                                        sharpshooters, marines,
+                                                        arabs, t_infantry);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* The bombardment, see resolve_naval_bombardment(), then the ground combat */
+static void solve_after_naval(struct naval_solve *naval,
+                              const struct assault_state *state)
+{
+    struct odds_dist killed;
+    int dice, k;
+
+    for (dice = 0; dice <= ASSAULT_MAX_BOMBARD_DICE; dice++) {
+        odds_roll(dice, 6, &killed);
+        odds_cap(&killed, state->t_infantry);
+        naval->after[dice] = 0;
+        for (k = 0; k <= killed.max; k++) {
+            naval->after[dice] += killed.p[k] *
+                ground_chance(state->lieutenant, state->sharpshooters,
+                              state->marines, state->arabs,
+                              state->t_infantry - k);
+        }
+    }
+}
+
+static double *naval_value(struct naval_solve *naval, const struct us_fleet *us,
+                           const struct t_fleet *t)
+{
+    int idx = us->frigates;
+
+    idx = idx * (ASSAULT_MAX_FRIGATES + 1) + us->damaged;
+    idx = idx * (MAX_GUNBOATS + 1) + us->gunboats;
+    idx = idx * (DESTROYED_FRIGATES_WIN + 1) + us->losses_left;
+    idx = idx * (ASSAULT_MAX_T_FRIGATES + 1) + t->frigates;
+    idx = idx * (ASSAULT_MAX_T_FRIGATES + 1) + t->damaged;
+    idx = idx * (MAX_TRIPOLI_CORSAIRS + 1) + t->corsairs;
+
+    return &naval->values[idx];
+}
+
+/* US hits taken the way apply_damage() in tbot.c takes them during the
+ * assault, damaging frigates first */
+static void t_take_hits(const struct t_fleet *t, int hits, struct t_fleet *next)
+{
+    int applied;
+
+    applied = min(hits, t->frigates);
+    next->frigates = t->frigates - applied;
+    next->damaged = t->damaged + applied;
+    hits -= applied;
+
+    applied = min(hits, t->corsairs);
+    next->corsairs = t->corsairs - applied;
+    hits -= applied;
+
+    next->damaged -= min(hits, next->damaged);
+}
+
+/* Damage assigned the way assign_naval_damage() applies it. Damaging more
+ * frigates than are left undamaged sinks damaged ones instead, and the
+ * undamaged ones left over are lost without counting */
+static void us_take_damage(const struct us_fleet *us, int destroy,
+                           int damage, int gunboats, struct us_fleet *next)
+{
+    int left = us->frigates - destroy;
+    int sunk;
+
+    *next = *us;
+    next->gunboats -= gunboats;
+    next->losses_left -= destroy;
+
+    if (damage > left) {
+        sunk = damage - left;
+        next->frigates = 0;
+        next->damaged -= sunk;
+        next->losses_left -= sunk;
+    } else {
+        next->frigates = left - damage;
+        next->damaged += damage;
+    }
+}
+
+static double solve_naval(struct naval_solve *naval, const struct us_fleet *us,
+                          const struct t_fleet *t, bool prebles_boys,
+                          bool guns_of_tripoli);
+
+/* Win chance once the US side has taken its damage, over every way the US
+ * hits could have landed */
+static double after_round(struct naval_solve *naval,
+                          const struct us_fleet *us,
+                          const struct t_fleet *t_next,
+                          const struct odds_dist *us_hits)
+{
+    double value = 0;
+    int hits;
+
+    if (us->losses_left <= 0) {
+        return 0;
+    }
+
+    for (hits = 0; hits <= us_hits->max; hits++) {
+        if (us_hits->p[hits] == 0) {
+            continue;
+        }
+        value += us_hits->p[hits] *
+            solve_naval(naval, us, &t_next[hits], false, false);
+    }
+
+    return value;
+}
+
+#define US_FLEETS ((ASSAULT_MAX_FRIGATES + 1) * (ASSAULT_MAX_FRIGATES + 1) * \
+                   (MAX_GUNBOATS + 1) * (DESTROYED_FRIGATES_WIN + 1))
+
+/* Many ways of taking the hits leave the same fleet, after_round() for each
+ * fleet is only worked out once a round */
+struct round_cache {
+    bool seen[US_FLEETS];
+    double value[US_FLEETS];
+};
+
+static double cached_after_round(struct naval_solve *naval,
+                                 struct round_cache *cache,
+                                 const struct us_fleet *us,
+                                 const struct t_fleet *t_next,
+                                 const struct odds_dist *us_hits)
+{
+    int idx = us->frigates;
+
+    if (us->losses_left <= 0) {
+        return 0;
+    }
+
+    idx = idx * (ASSAULT_MAX_FRIGATES + 1) + us->damaged;
+    idx = idx * (MAX_GUNBOATS + 1) + us->gunboats;
+    idx = idx * (DESTROYED_FRIGATES_WIN + 1) + us->losses_left;
+    if (!cache->seen[idx]) {
+        cache->seen[idx] = true;
+        cache->value[idx] = after_round(naval, us, t_next, us_hits);
+    }
+
+    return cache->value[idx];
+}
+
+/* One round of resolve_naval_battle() in Tripoli harbor and everything after
+ * it. The cards still held are played in this round */
+static double solve_naval(struct naval_solve *naval, const struct us_fleet *us,
+                          const struct t_fleet *t, bool prebles_boys,
+                          bool guns_of_tripoli)
+{
+    struct t_fleet t_next[ODDS_MAX_DICE + 1];
+    struct odds_dist us_hits;
+    struct odds_dist t_hits;
+    struct us_fleet next;
+    struct round_cache cache;
+    double *memo = NULL;
+    double p_same = 0;
+    double value = 0;
+    double best;
+    int frigates = us->frigates + us->damaged;
+    int hits, destroy, gunboats, damage;
+
+    /* The battle is over, see location_battle() */
+    if (us->frigates == 0) {
+        return naval->after[0];
+    }
+    if (t->frigates == 0 && t->corsairs == 0) {
+        return naval->after[frigates * FRIGATE_DICE + us->gunboats];
+    }
+
+    if (!prebles_boys && !guns_of_tripoli) {
+        memo = naval_value(naval, us, t);
+        if (*memo >= 0) {
+            return *memo;
+        }
+    }
+
+    odds_roll(frigates * ((prebles_boys) ? 3 : FRIGATE_DICE) + us->gunboats,
+              6, &us_hits);
+    odds_cap(&us_hits, t->frigates * 2 + t->damaged + t->corsairs);
+    odds_roll((t->frigates + t->damaged) * FRIGATE_DICE + t->corsairs +
+              ((guns_of_tripoli) ? 12 : 0), 6, &t_hits);
+    odds_cap(&t_hits, us->frigates * 2 + us->damaged + us->gunboats);
+
+    for (hits = 0; hits <= us_hits.max; hits++) {
+        t_take_hits(t, hits, &t_next[hits]);
+    }
+    memset(cache.seen, 0, sizeof(cache.seen));
+
+    for (hits = 0; hits <= t_hits.max; hits++) {
+        if (hits == 0) {
+            if (memo != NULL) {
+                /* Missing on both sides fights the same round again */
+                p_same = us_hits.p[0];
+                us_hits.p[0] = 0;
+            }
+            best = after_round(naval, us, t_next, &us_hits);
+            if (memo != NULL) {
+                us_hits.p[0] = p_same;
+                p_same *= t_hits.p[0];
+            }
+        } else if (hits == us->frigates * 2 + us->damaged + us->gunboats) {
+            /* try_auto_assign_naval_battle() clears out the whole fleet
+             * without counting the frigates as destroyed */
+            next = *us;
+            next.frigates = 0;
+            next.damaged = 0;
+            next.gunboats = 0;
+            best = after_round(naval, &next, t_next, &us_hits);
+        } else {
+            best = 0;
+            for (destroy = 0; destroy * 2 <= hits && destroy <= us->frigates;
+                 destroy++) {
+                for (gunboats = 0; gunboats <= us->gunboats &&
+                     destroy * 2 + gunboats <= hits; gunboats++) {
+                    damage = hits - destroy * 2 - gunboats;
+                    if (destroy + damage > frigates) {
+                        continue;
+                    }
+                    us_take_damage(us, destroy, damage, gunboats, &next);
+                    best = fmax(best,
+                                cached_after_round(naval, &cache, &next,
+                                                   t_next, &us_hits));
+                }
+            }
+        }
+        value += t_hits.p[hits] * best;
+    }
+
+    value /= 1 - p_same;
+    if (memo != NULL) {
+        *memo = value;
+    }
+    return value;
+}
+
+/* The naval table only holds for one set of ground forces, switching to
+ * another throws it away */
+static double naval_chance(struct naval_solve *naval,
+                           const struct assault_state *state)
+{
+    struct us_fleet us = {
+        .frigates = state->frigates,
+        .damaged = state->damaged_frigates,
+        .gunboats = state->gunboats,
+        .losses_left = state->losses_left,
+    };
+    struct t_fleet t = {
+        .frigates = state->t_frigates,
+        .damaged = state->t_damaged_frigates,
+        .corsairs = state->t_corsairs,
+    };
+    int i;
+
+    if (!naval->valid || naval->ground.marines != state->marines ||
+        naval->ground.arabs != state->arabs ||
+        naval->ground.t_infantry != state->t_infantry ||
+        naval->ground.lieutenant != state->lieutenant ||
+        naval->ground.sharpshooters != state->sharpshooters) {
+        naval->ground = *state;
+        naval->valid = true;
+        solve_after_naval(naval, state);
+        for (i = 0; i < NAVAL_STATES; i++) {
+            naval->values[i] = -1;
+        }
+    }
+
+    return solve_naval(naval, &us, &t, state->prebles_boys,
+                       state->guns_of_tripoli);
+}
+
+static uint32_t tablebase_entries(void)
+{
+    uint32_t entries = 1;
+    int i;
+
+    for (i = 0; i < TB_DIMS; i++) {
+        entries *= tablebase_dims[i];
+    }
+
+    return entries;
+}
+
+/* -1 if the tablebase doesn't hold the position */
+static long tablebase_index(const struct assault_state *state)
+{
+    int coords[TB_DIMS] = {
+        [TB_LIEUTENANT] = state->lieutenant,
+        [TB_SHARPSHOOTERS] = state->sharpshooters,
+        [TB_T_INFANTRY] = state->t_infantry,
+        [TB_MARINES] = state->marines,
+        [TB_ARABS] = state->arabs,
+        [TB_GUNS_OF_TRIPOLI] = state->guns_of_tripoli,
+        [TB_PREBLES_BOYS] = state->prebles_boys,
+        [TB_FRIGATES] = state->frigates,
+        [TB_GUNBOATS] = state->gunboats,
+        [TB_LOSSES_LEFT] = state->losses_left - 1,
+        [TB_T_FRIGATES] = state->t_frigates,
+        [TB_T_CORSAIRS] = state->t_corsairs,
+    };
+    long idx = 0;
+    int i;
+
+    if (state->damaged_frigates != 0 || state->t_damaged_frigates != 0) {
+        return -1;
+    }
+
+    for (i = 0; i < TB_DIMS; i++) {
+        if (coords[i] < 0 || coords[i] >= tablebase_dims[i]) {
+            return -1;
+        }
+        idx = idx * tablebase_dims[i] + coords[i];
+    }
+
+    return idx;
+}
+
+static uint64_t tablebase_checksum(const uint16_t *values, uint32_t entries)
+{
+    uint64_t checksum = 0xcbf29ce484222325ULL;
+    uint32_t i;
+
+    for (i = 0; i < entries; i++) {
+        checksum = (checksum ^ values[i]) * 0x100000001b3ULL;
+    }
+
+    return checksum;
+}
+
+/* Looks the position up without solving anything, safe from any thread once
+ * the tablebase is loaded */
+bool assault_tablebase_chance(const struct assault_state *state, double *chance)
+{
+    long idx;
+
+    if (tablebase.values == NULL) {
+        return false;
+    }
+
+    idx = tablebase_index(state);
+    if (idx < 0) {
+        return false;
+    }
+
+    *chance = (double)tablebase.values[idx] / TABLEBASE_SCALE;
+    return true;
+}
+
+/* Maps the file written by assault_write_tablebase(), call it before starting
+ * any threads */
+const char *assault_load_tablebase(const char *path)
+{
+    const struct tablebase_header *header;
+    struct stat st;
+    void *map;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return "Can't open the tablebase";
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < sizeof(*header)) {
+        close(fd);
+        return "Tablebase is truncated";
+    }
+
+#if !defined(__MINGW32__)
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return "Can't map the tablebase";
+    }
+#else
+    map = malloc(st.st_size);
+    if (map == NULL || read(fd, map, st.st_size) != st.st_size) {
+        free(map);
+        close(fd);
+        return "Can't read the tablebase";
+    }
+    close(fd);
+#endif /* !defined(__MINGW32__) */
+
+    header = map;
+    if (memcmp(header->magic, TABLEBASE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != TABLEBASE_VERSION ||
+        memcmp(header->dims, tablebase_dims, sizeof(tablebase_dims)) != 0 ||
+        header->entries != tablebase_entries() ||
+        st.st_size != sizeof(*header) + header->entries * sizeof(uint16_t) ||
+        header->checksum != tablebase_checksum((const uint16_t *)(header + 1),
+                                               header->entries)) {
+#if !defined(__MINGW32__)
+        munmap(map, st.st_size);
+#else
+        free(map);
+#endif /* !defined(__MINGW32__) */
+        return "Tablebase is from another version or corrupt";
+    }
+
+    tablebase.header = header;
+    tablebase.values = (const uint16_t *)(header + 1);
+    tablebase.bytes = st.st_size;
+    return NULL;
+}
+
+/* The position stored at idx, the inverse of tablebase_index() */
+static void tablebase_state(uint32_t idx, struct assault_state *state)
+{
+    uint32_t coord;
+    int i;
+
+    memset(state, 0, sizeof(*state));
+
+    for (i = TB_DIMS - 1; i >= 0; i--) {
+        coord = idx % tablebase_dims[i];
+        idx /= tablebase_dims[i];
+        switch (i) {
+            case TB_LIEUTENANT:
+                state->lieutenant = coord;
+                break;
+            case TB_SHARPSHOOTERS:
+                state->sharpshooters = coord;
+                break;
+            case TB_T_INFANTRY:
+                state->t_infantry = coord;
+                break;
+            case TB_MARINES:
+                state->marines = coord;
+                break;
+            case TB_ARABS:
+                state->arabs = coord;
+                break;
+            case TB_GUNS_OF_TRIPOLI:
+                state->guns_of_tripoli = coord;
+                break;
+            case TB_PREBLES_BOYS:
+                state->prebles_boys = coord;
+                break;
+            case TB_FRIGATES:
+                state->frigates = coord;
+                break;
+            case TB_GUNBOATS:
+                state->gunboats = coord;
+                break;
+            case TB_LOSSES_LEFT:
+                state->losses_left = coord + 1;
+                break;
+            case TB_T_FRIGATES:
+                state->t_frigates = coord;
+                break;
+            case TB_T_CORSAIRS:
+                state->t_corsairs = coord;
+                break;
+        }
+    }
+}
+
+/* Each writer thread takes every step'th set of ground forces starting from
+ * first, with a naval table of its own */
+struct tablebase_worker {
+    pthread_t thread;
+    struct naval_solve *naval;
+    uint16_t *values;
+    uint32_t first;
+    uint32_t step;
+};
+
+/* Positions that share the ground forces are next to each other */
+#define TABLEBASE_GROUND_DIMS (TB_GUNS_OF_TRIPOLI)
+
+static void *tablebase_worker_run(void *arg)
+{
+    struct tablebase_worker *worker = arg;
+    struct assault_state state;
+    uint32_t per_ground = 1;
+    uint32_t grounds = 1;
+    uint32_t ground, idx, i;
+
+    for (i = 0; i < TB_DIMS; i++) {
+        if (i < TABLEBASE_GROUND_DIMS) {
+            grounds *= tablebase_dims[i];
+        } else {
+            per_ground *= tablebase_dims[i];
+        }
+    }
+
+    for (ground = worker->first; ground < grounds; ground += worker->step) {
+        for (idx = ground * per_ground; idx < (ground + 1) * per_ground;
+             idx++) {
+            tablebase_state(idx, &state);
+            assert(tablebase_index(&state) == idx);
+            worker->values[idx] =
+                lround(naval_chance(worker->naval, &state) * TABLEBASE_SCALE);
+        }
+    }
+
+    return NULL;
+}
+
+/* Opens a new file next to path to write the tablebase to, named uniquely
+ * where the platform allows so two solves at once don't share it */
+static const char *create_temp(const char *path, char *tmp_path, size_t size,
+                               FILE **file)
+{
+#if !defined(__MINGW32__)
+    int fd;
+
+    if (snprintf(tmp_path, size, "%s.XXXXXX", path) >= size) {
+        return "Tablebase path is too long";
+    }
+    fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        return "Can't create the tablebase";
+    }
+    /* mkstemp() only lets the owner read it */
+    fchmod(fd, 0644);
+    *file = fdopen(fd, "wb");
+    if (*file == NULL) {
+        close(fd);
+        remove(tmp_path);
+        return "Can't create the tablebase";
+    }
+#else
+    if (snprintf(tmp_path, size, "%s.tmp", path) >= size) {
+        return "Tablebase path is too long";
+    }
+    *file = fopen(tmp_path, "wb");
+    if (*file == NULL) {
+        return "Can't create the tablebase";
+    }
+#endif /* !defined(__MINGW32__) */
+
+    return NULL;
+}
+
+/* Solves every position the tablebase holds, the sets of ground forces are
+ * split between threads */
+const char *assault_write_tablebase(const char *path, int threads)
+{
+    struct tablebase_header header = {
+        .magic = TABLEBASE_MAGIC,
+        .version = TABLEBASE_VERSION,
+        .entries = tablebase_entries(),
+    };
+    struct tablebase_worker *workers;
+    const char *err = NULL;
+    char tmp_path[PATH_MAX];
+    uint16_t *values;
+    FILE *file;
+    bool ok;
+    int i;
+
+    assert(threads > 0);
+
+    /* Running copies of sot have the old file mapped, it's replaced with a
+     * new one rather than written over so they keep reading the old one.
+     * Created first so a bad path fails before minutes of solving */
+    err = create_temp(path, tmp_path, sizeof(tmp_path), &file);
+    if (err != NULL) {
+        return err;
+    }
+
+    pthread_once(&ground_once, solve_ground_table);
+
+    values = malloc(header.entries * sizeof(*values));
+    workers = calloc(threads, sizeof(*workers));
+    if (values == NULL || workers == NULL) {
+        free(values);
+        free(workers);
+        fclose(file);
+        remove(tmp_path);
+        return "Not enough memory for the tablebase";
+    }
+
+    for (i = 0; i < threads; i++) {
+        workers[i].naval = malloc(sizeof(*workers[i].naval));
+        if (workers[i].naval == NULL) {
+            err = "Not enough memory for the tablebase";
+            break;
+        }
+        workers[i].naval->valid = false;
+        workers[i].values = values;
+        workers[i].first = i;
+        workers[i].step = threads;
+        if (pthread_create(&workers[i].thread, NULL, tablebase_worker_run,
+                           &workers[i]) != 0) {
+            free(workers[i].naval);
+            err = "Can't start the tablebase threads";
+            break;
+        }
+    }
+    threads = i;
+    for (i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        free(workers[i].naval);
+    }
+    free(workers);
+    if (err != NULL) {
+        free(values);
+        fclose(file);
+        remove(tmp_path);
+        return err;
+    }
+
+    memcpy(header.dims, tablebase_dims, sizeof(header.dims));
+    header.checksum = tablebase_checksum(values, header.entries);
+
+    ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(values, sizeof(*values), header.entries, file) ==
+        header.entries;
+    ok = (fflush(file) == 0) && ok;
+#if !defined(__MINGW32__)
+    ok = (fsync(fileno(file)) == 0) && ok;
+#else
+    ok = (_commit(fileno(file)) == 0) && ok;
+#endif /* !defined(__MINGW32__) */
+    ok = (fclose(file) == 0) && ok;
+    free(values);
+
+#if defined(__MINGW32__)
+    /* Windows won't rename over a file that exists */
+    if (ok) {
+        remove(path);
+    }
+#endif /* defined(__MINGW32__) */
+    if (!ok || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return "Can't write the tablebase";
+    }
+
+    return NULL;
+}
+
+/* The position as it would be the moment Assault on Tripoli resolves if it
+ * isn't under way yet, see play_assault_on_tripoli() */
+void assault_state_from_game(struct game_state *game,
+                             struct assault_state *state)
+{
+    int us_idx = us_infantry_idx(TRIPOLI);
+    int benghazi_idx = us_infantry_idx(BENGHAZI);
+    int i;
+
+    memset(state, 0, sizeof(*state));
+
+    state->frigates = game->us_frigates[TRIPOLI];
+    state->damaged_frigates = game->us_damaged_frigates;
+    state->gunboats = game->us_gunboats;
+    state->losses_left = DESTROYED_FRIGATES_WIN - game->destroyed_us_frigates;
+    state->marines = game->marine_infantry[us_idx];
+    state->arabs = game->arab_infantry[us_idx];
+    state->t_frigates = game->t_frigates;
+    state->t_damaged_frigates = game->t_damaged_frigates;
+    state->t_corsairs = game->t_corsairs_tripoli;
+    state->t_infantry = game->t_infantry[trip_infantry_idx(TRIPOLI)];
+    state->guns_of_tripoli = tbot_holds_battle_card(game, &the_guns_of_tripoli);
+    state->prebles_boys = card_in_hand(game, &prebles_boys) >= 0;
+    state->lieutenant = card_in_hand(game, &lieutenant_leads_the_charge) >= 0;
+    state->sharpshooters = card_in_hand(game, &marine_sharpshooters) >= 0;
+
+    if (game->victory_or_death) {
+        return;
+    }
+
+    state->frigates = 0;
+    for (i = 0; i < NUM_LOCATIONS; i++) {
+        state->frigates += game->us_frigates[i];
+        if (has_patrol_zone(i)) {
+            state->frigates += game->patrol_frigates[i];
+        }
+    }
+    state->marines += game->marine_infantry[benghazi_idx];
+    state->arabs += game->arab_infantry[benghazi_idx];
+    if (card_in_hand(game, &send_in_the_marines) >= 0) {
+        state->marines += 3;
+    }
+}
+
+/* Exact chance the US wins the rest of the assault, taking damage the best way
+ * every time. Held cards are played as soon as they can be and every gunboat
+ * joins the battle. False if the forces are bigger than the solver handles */
+bool assault_win_chance(const struct assault_state *state, double *chance)
+{
+    if (state->frigates < 0 || state->damaged_frigates < 0 ||
+        state->frigates + state->damaged_frigates > ASSAULT_MAX_FRIGATES ||
+        state->gunboats < 0 || state->gunboats > MAX_GUNBOATS ||
+        state->t_frigates < 0 || state->t_damaged_frigates < 0 ||
+        state->t_frigates + state->t_damaged_frigates >
+        ASSAULT_MAX_T_FRIGATES ||
+        state->t_corsairs < 0 || state->t_corsairs > MAX_TRIPOLI_CORSAIRS ||
+        state->marines < 0 || state->marines > ASSAULT_MAX_MARINES ||
+        state->arabs < 0 || state->arabs > ASSAULT_MAX_ARABS ||
+        state->t_infantry < 0 || state->t_infantry > ASSAULT_MAX_T_INFANTRY ||
+        state->losses_left > DESTROYED_FRIGATES_WIN) {
+        return false;
+    }
+
+    if (state->losses_left <= 0) {
+        *chance = 0;
+        return true;
+    }
+
+    if (assault_tablebase_chance(state, chance)) {
+        return true;
+    }
+
+    pthread_once(&ground_once, solve_ground_table);
+
+    pthread_mutex_lock(&naval_lock);
+    *chance = naval_chance(&naval, state);
+    pthread_mutex_unlock(&naval_lock);
+
+    return true;
+}
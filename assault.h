@@ -0,0 +1,51 @@
+#ifndef ASSAULT_H
+#define ASSAULT_H
+
+#include <stdbool.h>
+
+#include "game.h"
+
+/* Largest forces the solver handles, every count the rules can reach fits */
+#define ASSAULT_MAX_FRIGATES (10)
+#define ASSAULT_MAX_T_FRIGATES (2)
+#define ASSAULT_MAX_MARINES (7)
+#define ASSAULT_MAX_ARABS (11)
+#define ASSAULT_MAX_T_INFANTRY (10)
+
+/* Solved ahead of time by make tablebase, loaded from the working directory */
+#define ASSAULT_TABLEBASE_FILE "assault.tb"
+
+/* Everything the rest of the game depends on once victory_or_death is set.
+ * The naval battle in Tripoli harbor runs until one side has nothing left to
+ * fight with, then the frigates bombard once and the ground combat runs to the
+ * end */
+struct assault_state {
+    /* US frigates and gunboats in Tripoli harbor */
+    int frigates;
+    int damaged_frigates;
+    int gunboats;
+    /* Frigates the US can still lose before Tripoli wins */
+    int losses_left;
+    int marines;
+    int arabs;
+    int t_frigates;
+    int t_damaged_frigates;
+    int t_corsairs;
+    int t_infantry;
+    /* Battle cards still to be played, each is played the first time it
+     * can be */
+    bool guns_of_tripoli;
+    bool prebles_boys;
+    bool lieutenant;
+    bool sharpshooters;
+};
+
+void assault_state_from_game(struct game_state *game,
+                             struct assault_state *state);
+bool assault_win_chance(const struct assault_state *state, double *chance);
+bool assault_tablebase_chance(const struct assault_state *state,
+                              double *chance);
+const char *assault_load_tablebase(const char *path);
+const char *assault_write_tablebase(const char *path, int threads);
+
+#endif /* ASSAULT_H */
@@ -6,6 +6,7 @@
 #include "display.h"
 #include "game.h"
 #include "input.h"
+#include "player.h"
 
 static bool battle_playable(struct game_state *game)
 {
@@ -14,12 +15,8 @@ static bool battle_playable(struct game_state *game)
 
 void remove_card_from_game(struct game_state *game, int idx)
 {
-    int i;
-
-    for (i = idx; i < game->hand_size - 1; i++) {
-        game->us_hand[i] = game->us_hand[i + 1];
-    }
-    game->us_hand[--game->hand_size] = NULL;
+    game_set(game, game->us_hand,
+             game->us_hand & ~(1u << mask_nth(game->us_hand, idx)));
 }
 
 static void move_hamets_army(struct game_state *game, enum locations from,
@@ -28,18 +25,20 @@ static void move_hamets_army(struct game_state *game, enum locations from,
     int from_idx = us_infantry_idx(from);
     int to_idx = us_infantry_idx(to);
 
-    game->marine_infantry[to_idx] += game->marine_infantry[from_idx];
-    game->marine_infantry[from_idx] = 0;
-    game->arab_infantry[to_idx] += game->arab_infantry[from_idx];
-    game->arab_infantry[from_idx] = 0;
+    game_add(game, game->marine_infantry[to_idx],
+             game->marine_infantry[from_idx]);
+    game_set(game, game->marine_infantry[from_idx], 0);
+    game_add(game, game->arab_infantry[to_idx], game->arab_infantry[from_idx]);
+    game_set(game, game->arab_infantry[from_idx], 0);
 }
 
-static int card_in_hand(struct game_state *game, struct card *card)
+/* Hand index of the card, -1 if it isn't in the hand */
+int card_in_hand(struct game_state *game, struct card *card)
 {
     int i;
 
-    for (i = 0; i < game->hand_size; i++) {
-        if (game->us_hand[i] == card) {
+    for (i = 0; i < hand_size(game); i++) {
+        if (hand_card(game, i) == card) {
             return i;
         }
     }
@@ -50,15 +49,13 @@ static int card_in_hand(struct game_state *game, struct card *card)
 bool check_play_battle_card(struct game_state *game, struct card *card)
 {
     int idx = card_in_hand(game, card);
-    char msg[128];
     bool play;
 
     if (idx == -1) {
         return false;
     }
 
-    snprintf(msg, sizeof(msg), "Play [ %s ] as a battle card?", card->name);
-    play = yn_prompt(msg);
+    play = game->player->play_battle_card(game, card);
     if (play) {
         remove_card_from_game(game, idx);
     }
@@ -67,9 +64,12 @@ bool check_play_battle_card(struct game_state *game, struct card *card)
 }
 
 /* Core US cards */
+#define THOMAS_JEFFERSON_MOVES (8)
+#define NAVAL_MOVEMENT_MOVES (4)
+
 static const char *play_thomas_jefferson(struct game_state *game)
 {
-    return game_move_ships(game, 8);
+    return game_move_ships(game, THOMAS_JEFFERSON_MOVES);
 }
 
 struct card thomas_jefferson = {
@@ -78,12 +78,13 @@ struct card thomas_jefferson = {
     "Resolve any battles that result",
     .remove_after_use = true,
     .playable = always_playable,
-    .play = play_thomas_jefferson
+    .play = play_thomas_jefferson,
+    .frigate_moves = THOMAS_JEFFERSON_MOVES
 };
 
 static const char *play_swedish_frigates(struct game_state *game)
 {
-    game->swedish_frigates_active = true;
+    game_set(game, game->swedish_frigates_active, true);
     return NULL;
 }
 
@@ -104,8 +105,8 @@ static const char *play_hamets_army(struct game_state *game)
 {
     int idx = us_infantry_idx(ALEXANDRIA);
 
-    game->marine_infantry[idx] = 1;
-    game->arab_infantry[idx] = 5;
+    game_set(game, game->marine_infantry[idx], 1);
+    game_set(game, game->arab_infantry[idx], 5);
 
     return NULL;
 }
@@ -196,8 +197,7 @@ static bool peace_treaty_playable(struct game_state *game)
 
 static const char *play_treaty(struct game_state *game)
 {
-    cprintf(ITALIC BLUE, "US Victory via Peace Treaty!\n");
-    exit(EXIT_SUCCESS);
+    game_over(game, US_TREATY_WIN);
 
     return NULL;
 }
@@ -230,27 +230,27 @@ static const char *play_assault_on_tripoli(struct game_state *game)
     int dest;
     bool marines_played;
 
-    game->victory_or_death = true;
+    game_set(game, game->victory_or_death, true);
 
     for (i = 0; i < NUM_LOCATIONS; i++) {
         frig_count += game->us_frigates[i];
-        game->us_frigates[i] = 0;
+        game_set(game, game->us_frigates[i], 0);
         if (has_patrol_zone(i)) {
             frig_count += game->patrol_frigates[i];
-            game->patrol_frigates[i] = 0;
+            game_set(game, game->patrol_frigates[i], 0);
         }
     }
 
-    game->us_frigates[TRIPOLI] = frig_count;
+    game_set(game, game->us_frigates[TRIPOLI], frig_count);
 
     /* Don't bother prompting, we're going in */
-    game->assigned_gunboats = game->us_gunboats;
+    game_set(game, game->assigned_gunboats, game->us_gunboats);
 
     dest = us_infantry_idx(TRIPOLI);
     /* Check as a courtesy, if the card is in hand you'd probably just play it */
     marines_played = check_play_battle_card(game, &send_in_the_marines);
     if (marines_played) {
-        game->marine_infantry[dest] += 3;
+        game_add(game, game->marine_infantry[dest], 3);
     }
 
     move_hamets_army(game, BENGHAZI, TRIPOLI);
@@ -274,7 +274,7 @@ struct card assault_on_tripoli = {
 
 static const char *play_naval_movement(struct game_state *game)
 {
-    return game_move_ships(game, 4);
+    return game_move_ships(game, NAVAL_MOVEMENT_MOVES);
 }
 
 /* 4 copies */
@@ -284,7 +284,8 @@ struct card naval_movement = {
     "Resolve any battles that result.",
     .remove_after_use = false,
     .playable = always_playable,
-    .play = play_naval_movement
+    .play = play_naval_movement,
+    .frigate_moves = NAVAL_MOVEMENT_MOVES
 };
 
 static bool early_deployment_playable(struct game_state *game)
@@ -297,28 +298,26 @@ static bool early_deployment_playable(struct game_state *game)
 
 static const char *play_early_deployment(struct game_state *game)
 {
-    char *line;
     enum locations location;
+    const char *err;
 
-    cprintf(BOLD WHITE, "Choose a patrol zone to deploy to\n");
-    prompt();
+    err = game->player->deploy_frigate(game, &location);
+    if (err != NULL) {
+        return err;
+    }
 
-    line = input_getline();
-    location = parse_location(line);
     if (location == INVALID_LOCATION) {
-        free(line);
         return "Invalid location";
     }
 
     if (!has_patrol_zone(location)) {
-        free(line);
         return "Chosen location has no patrol zone";
     }
 
-    game->patrol_frigates[location]++;
-    game->turn_track_frigates[year_to_frigate_idx(game->year + 1)]--;
+    game_add(game, game->patrol_frigates[location], 1);
+    game_sub(game,
+             game->turn_track_frigates[year_to_frigate_idx(game->year + 1)], 1);
 
-    free(line);
     return NULL;
 }
 
@@ -352,99 +351,45 @@ static bool trip_allies_active(struct game_state *game)
 
 static const char *play_show_of_force(struct game_state *game)
 {
-    char *line;
-    char *ally_str;
     enum locations ally_loc;
     struct frigate_move moves[3];
     int num_moves = 0;
-    char *from_str;
-    char *from_zone_str;
-    char *quantity_str;
-    int count;
     int i;
     int frigates_moved = 0;
     const char *err;
 
-    cprintf(BOLD WHITE, "Choose which Tripoli ally to return to supply and what frigates to move: "
-            "[algiers/tangier/tunis] [location] [patrol/harbor] [quantity]...\n");
-    prompt();
-    line = input_getline();
-
-    ally_str = strtok(line, sep);
-    if (ally_str == NULL) {
-        free(line);
-        return "No Tripolitan ally selected";
+    err = game->player->show_of_force(game, &ally_loc, moves, &num_moves);
+    if (err != NULL) {
+        return err;
     }
 
-    ally_loc = parse_location(ally_str);
-    if (!has_trip_allies(ally_loc)) {
-        free(line);
+    if (ally_loc == INVALID_LOCATION || !has_trip_allies(ally_loc)) {
         return "Invalid ally location selected";
     }
 
     if (game->t_allies[ally_loc] == 0) {
-        free(line);
         return "Selected ally is not active";
     }
 
-    while (true) {
-        from_str = strtok(NULL, sep);
-        if (from_str == NULL) {
-            break;
-        }
-        from_zone_str = strtok(NULL, sep);
-        if (from_zone_str == NULL) {
-            free(line);
-            return "Missing location zone, patrol or harbor";
-        }
-        quantity_str = strtok(NULL, sep);
-        if (quantity_str == NULL) {
-            free(line);
-            return "No quantity of frigates to move provided";
-        }
-
-        moves[num_moves].from = parse_location(from_str);
-        moves[num_moves].from_zone = parse_zone(from_zone_str);
-        if (moves[num_moves].from == INVALID_LOCATION) {
-            free(line);
-            return "Invalid location for move provided";
-        }
-        if (moves[num_moves].from_zone == INVALID_ZONE) {
-            free(line);
-            return "Invalid location zone provided";
-        }
-        if (!game_strtol(quantity_str, &count)) {
-            free(line);
-            return "Invalid move quantity provided";
-        }
-
-        moves[num_moves].quantity = count;
-
-        moves[num_moves].to = ally_loc;
-        moves[num_moves].to_zone = HARBOR;
-        num_moves++;
-    }
-
     for (i = 0; i < num_moves; i++) {
+        moves[i].to = ally_loc;
+        moves[i].to_zone = HARBOR;
         frigates_moved += moves[i].quantity;
     }
 
     if (frigates_moved != 3) {
-        free(line);
         return "You must move exactly 3 frigates";
     }
 
     err = validate_moves(game, moves, num_moves, 3);
     if (err != NULL) {
-        free(line);
         return err;
     }
 
     move_frigates(game, moves, num_moves);
 
-    game->t_allies[ally_loc] = 0;
+    game_set(game, game->t_allies[ally_loc], 0);
 
-    free(line);
     return NULL;
 }
 
@@ -462,84 +407,55 @@ struct card a_show_of_force = {
 
 static const char *play_tribute_paid(struct game_state *game)
 {
-    char *line;
-    char *from_str;
-    char *zone_str;
-    char *to_str;
     enum locations from_loc;
     enum zone from_zone;
     enum locations to_loc;
+    struct frigate_move move;
+    const char *err;
 
-    cprintf(BOLD, "Choose location to move frigate from and location to move "
-            "to. [location] [harbor/patrol] [algiers/tunis/tangier]\n");
-    prompt();
-    line = input_getline();
-
-    from_str = strtok(line, sep);
-    if (from_str == NULL) {
-        free(line);
-        return "No location to move frigate from provided";
-    }
-
-    zone_str = strtok(NULL, sep);
-    if (zone_str == NULL) {
-        free(line);
-        return "No harbor or patrol zone specified";
-    }
-
-    to_str = strtok(NULL, sep);
-    if (to_str == NULL) {
-        free(line);
-        return "Destination harbor not specified";
+    err = game->player->tribute_paid(game, &to_loc, &move);
+    if (err != NULL) {
+        return err;
     }
 
-    from_loc = parse_location(from_str);
+    from_loc = move.from;
+    from_zone = move.from_zone;
     if (from_loc == INVALID_LOCATION) {
-        free(line);
         return "Invalid location to move frigate from";
     }
 
-    from_zone = parse_zone(zone_str);
     if (from_zone == INVALID_ZONE) {
-        free(line);
         return "Invalid harbor or patrol zone specified";
     }
 
-    to_loc = parse_location(to_str);
     if (to_loc != ALGIERS && to_loc != TUNIS && to_loc != TANGIER) {
-        free(line);
         return "Invalid destination location, must be one of algiers, tunis, "
             "or tangier";
     }
 
     if (game->t_allies[to_loc] == 0) {
-        free(line);
         return "No tripolitan allies at that location";
     }
 
     if (from_zone == PATROL_ZONE) {
         if (!has_patrol_zone(from_loc)) {
-            free(line);
             return "Location to move from does not have a patrol zone";
         }
         if (game->patrol_frigates[from_loc] == 0) {
-            free(line);
             return "No frigates at location to move";
         }
-        game->patrol_frigates[from_loc]--;
+        game_sub(game, game->patrol_frigates[from_loc], 1);
     } else {
         if (game->us_frigates[from_loc] == 0) {
-            free(line);
             return "no frigates at location to move";
         }
-        game->us_frigates[from_loc]--;
+        game_sub(game, game->us_frigates[from_loc], 1);
     }
 
-    game->us_frigates[to_loc]++;
-    game->t_allies[to_loc] = 0;
-    game->pirated_gold += 2;
+    game_add(game, game->us_frigates[to_loc], 1);
+    game_set(game, game->t_allies[to_loc], 0);
+    game_add(game, game->pirated_gold, 2);
 
-    free(line);
     return NULL;
 }
 
@@ -564,9 +480,9 @@ static bool constantinople_tribute_playable(struct game_state *game)
 static const char *play_constantinople_tribute(struct game_state *game)
 {
     if (game->pirated_gold < 2) {
-        game->pirated_gold = 0;
+        game_set(game, game->pirated_gold, 0);
     } else {
-        game->pirated_gold -= 2;
+        game_sub(game, game->pirated_gold, 2);
     }
 
     return NULL;
@@ -600,7 +516,7 @@ static const char *play_recruit_bedouins(struct game_state *game)
 
     for (i = US_INFANTRY_START; i <= US_INFANTRY_END; i++) {
         if (hamets_army_at(game, i)) {
-            game->arab_infantry[us_infantry_idx(i)] += 2;
+            game_add(game, game->arab_infantry[us_infantry_idx(i)], 2);
             return NULL;
         }
     }
@@ -622,70 +538,53 @@ struct card hamet_recruits_bedouins = {
 
 static bool brainbridge_playable(struct game_state *game)
 {
-    return game->discard_size > 0;
+    return game->us_discard != 0;
+}
+
+static void take_from_discard(struct game_state *game, int id)
+{
+    game_set(game, game->us_discard, game->us_discard & ~(1u << id));
+    game_set(game, game->us_hand, game->us_hand | 1u << id);
 }
 
 static const char *play_brainbridge_supplies_intel(struct game_state *game)
 {
-    char *line;
-    char *action;
-    char *idx_str;
+    bool play;
     int idx;
+    int id;
     const char *err;
     struct card *card;
 
-    print_discard_pile(game);
-    cprintf(BOLD WHITE, "Choose which card to take or play "
-            "(ex : \"take 3\", \"play 2\", \"t 0\", \"p 3\"):\n");
-    prompt();
-
-    line = input_getline();
-
-    action = strtok(line, sep);
-    if (action == NULL) {
-        free(line);
-        return "Invalid action for [ Brainbridge Supplies Intel ]";
-    }
-
-    idx_str = strtok(NULL, sep);
-    if (idx_str == NULL) {
-        free(line);
-        return "No card selected";
+    err = game->player->choose_from_discard(game, &play, &idx);
+    if (err != NULL) {
+        return err;
     }
 
-    if (!game_strtol(idx_str, &idx) || idx < 0 || idx >= game->discard_size) {
-        free(line);
+    if (idx < 0 || idx >= discard_size(game)) {
         return "Invalid card number";
     }
 
-    card = game->us_discard[idx];
-    assert(card);
-    assert(card->play);
+    id = mask_nth(game->us_discard, idx);
+    card = us_cards[id];
 
-    if (strcmp(action, "play") == 0 || strcmp(action, "p") == 0) {
-        if (!card->playable(game)) {
-            free(line);
+    if (play) {
+        /* Battle cards can only be taken, they have nothing to play */
+        if (card->play == NULL || !card_playable(game, id)) {
             return "Chosen card not playable";
         }
         err = card->play(game);
         if (err != NULL) {
-            free(line);
             return err;
         }
         if (card->remove_after_use) {
-            game->us_discard[idx] = game->us_discard[game->discard_size - 1];
-            game->us_discard[--game->discard_size] = NULL;
+            game_set(game, game->us_discard, game->us_discard & ~(1u << id));
         }
         /* If the card isn't removed after use we just leave it in the discard
          * pile */
-    } else if (strcmp(action, "take") == 0 || strcmp(action, "t") == 0) {
-        game->us_hand[game->hand_size++] = card;
     } else {
-        free(line);
-        return "Invalid action, must take or play a card";
+        take_from_discard(game, id);
     }
 
-    free(line);
     return NULL;
 }
 
@@ -705,7 +604,8 @@ static const char *play_congress_authorizes_action(struct game_state *game)
         return NULL;
     }
 
-    game->turn_track_frigates[year_to_frigate_idx(game->year + 1)] += 2;
+    game_add(game,
+             game->turn_track_frigates[year_to_frigate_idx(game->year + 1)], 2);
     return NULL;
 }
 
@@ -728,7 +628,7 @@ static const char *play_corsairs_confiscated(struct game_state *game)
     /* We don't need to remove Murad Reis Breaks out as setting the corsairs to
      * zero will cause the playable() check to fail
     */
-    game->t_corsairs_gibraltar = 0;
+    game_set(game, game->t_corsairs_gibraltar, 0);
 
     return NULL;
 }
@@ -753,19 +653,17 @@ static bool burn_the_philly_playable(struct game_state *game)
 static const char *play_burn_the_philly(struct game_state *game)
 {
     bool roll_again = check_play_battle_card(game, &daring_decatur);
-    unsigned int roll = rolld6();
-
-    if (roll_again) {
-        roll = max(roll, rolld6());
-    }
+    unsigned int roll = rolld6_best(game, (roll_again) ? 2 : 1);
 
     if (roll == 3 || roll == 4) {
-        game->t_frigates--;
+        game_sub(game, game->t_frigates, 1);
         if (game->year < 1806) {
-            game->t_turn_frigates[year_to_frigate_idx(game->year + 1)]++;
+            game_add(game,
+                     game->t_turn_frigates[year_to_frigate_idx(game->year + 1)],
+                     1);
         }
     } else if (roll == 5 || roll == 6) {
-        game->t_frigates--;
+        game_sub(game, game->t_frigates, 1);
     }
 
     return NULL;
@@ -789,21 +687,21 @@ struct card burn_the_philadelphia = {
 static void sink_corsairs_at(struct game_state *game, enum locations location,
                              int count)
 {
-    unsigned int *corsairs = tripoli_corsair_ptr(game, location);
+    uint8_t *corsairs = tripoli_corsair_ptr(game, location);
 
     if (*corsairs < count) {
-        *corsairs = 0;
+        game_set(game, *corsairs, 0);
     } else {
-        *corsairs -= count;
+        game_sub(game, *corsairs, count);
     }
 }
 
 static const char *sink_corsairs(struct game_state *game, int count)
 {
-    char *line;
-    char *loc_str;
-    int loc_count = 1;
+    int loc_count = 0;
     enum locations loc[2];
+    const char *err;
+    int i;
 
     /* If there's only one choice don't bother prompting */
     if (game->t_corsairs_gibraltar == 0) {
@@ -811,42 +709,25 @@ static const char *sink_corsairs(struct game_state *game, int count)
         return NULL;
     }
 
-    /* There's probably a simpler way to handle this since there's only 2
-     * locations where Tripolitan corsairs can be */
-    cprintf(BOLD WHITE, "Choose locations to sink up to 2 corsairs from\n");
-    prompt();
-    line = input_getline();
+    err = game->player->sink_corsairs(game, count, loc, &loc_count);
+    if (err != NULL) {
+        return err;
+    }
 
-    loc_str = strtok(line, sep);
-    if (loc_str == NULL) {
-        free(line);
+    if (loc_count == 0) {
         return "No locations provided";
     }
 
-    loc[0] = parse_location(loc_str);
-    if (!tripoli_corsair_location(loc[0])) {
-        free(line);
-        return "Invalid location";
+    if (loc_count > count) {
+        return "Too many locations provided";
     }
 
-    if (count == 2) {
-        loc_str = strtok(NULL, sep);
-        if (loc_str != NULL) {
-            loc[1] = parse_location(loc_str);
-            if (!tripoli_corsair_location(loc[1])) {
-                free(line);
-                return "Invalid location";
-            }
-            loc_count++;
+    for (i = 0; i < loc_count; i++) {
+        if (!tripoli_corsair_location(loc[i])) {
+            return "Invalid location";
         }
     }
 
-    loc_str = strtok(NULL, sep);
-    if (loc_str != NULL) {
-        free(line);
-        return "Too many locations provided";
-    }
-
     if (loc_count == 1) {
         sink_corsairs_at(game, loc[0], count);
     } else {
@@ -854,24 +735,19 @@ static const char *sink_corsairs(struct game_state *game, int count)
         sink_corsairs_at(game, loc[1], 1);
     }
 
-    free(line);
     return NULL;
 }
 
 static const char *play_launch_the_intrepid(struct game_state *game)
 {
     bool roll_again = check_play_battle_card(game, &daring_decatur);
-    unsigned int roll = rolld6();
-
-    if (roll_again) {
-        roll = max(roll, rolld6());
-    }
+    unsigned int roll = rolld6_best(game, (roll_again) ? 2 : 1);
 
     if (roll == 3 || roll == 4) {
         return sink_corsairs(game, 1);
     } else if (roll == 5 || roll == 6) {
         if (game->t_frigates > 0) {
-            game->t_frigates--;
+            game_sub(game, game->t_frigates, 1);
         } else {
             return sink_corsairs(game, 2);
         }
@@ -901,87 +777,28 @@ static bool hamets_army_in_alexandria(struct game_state *game)
 static const char *hamet_move_frigates(struct game_state *game,
                                        enum locations dest)
 {
-    char *line;
     struct frigate_move moves[3];
     int move_count = 0;
-    bool first = true;
-    char *loc_str;
-    char *zone_str;
-    char *quantity_str;
-    enum locations loc;
-    enum zone zone;
-    int quantity;
     const char *err;
+    int i;
 
-    cprintf(BOLD WHITE, "Move up to three frigates to the %s harbor: "
-            "[location] [patrol/harbor] [quantity]...\n", location_str(dest));
-    prompt();
-
-    line = input_getline();
-
-    while (true) {
-        if (move_count > 3) {
-            free(line);
-            return "Too many moves specified";
-        }
-        if (first) {
-            loc_str = strtok(line, sep);
-            first = false;
-        } else {
-            loc_str = strtok(NULL, sep);
-        }
-
-        if (loc_str == NULL) {
-            break;
-        }
-
-        zone_str = strtok(NULL, sep);
-        if (zone_str == NULL) {
-            free(line);
-            return "Patrol Zone or Harbor not specified for move";
-        }
-
-        quantity_str = strtok(NULL, sep);
-        if (quantity_str == NULL) {
-            free(line);
-            return "No move quantity specified";
-        }
-
-        loc = parse_location(loc_str);
-        if (loc == INVALID_LOCATION) {
-            free(line);
-            return "Invalid location specified";
-        }
-
-        zone = parse_zone(zone_str);
-        if (zone == INVALID_ZONE) {
-            free(line);
-            return "Invalid zone specified. Must be harbor or patrol";
-        }
-
-        if (!game_strtol(quantity_str, &quantity)) {
-            free(line);
-            return "Invalid move quantity specified";
-        }
-
-        moves[move_count].from = loc;
-        moves[move_count].from_zone = zone;
-        moves[move_count].quantity = quantity;
+    err = game->player->hamet_move_frigates(game, dest, moves, &move_count);
+    if (err != NULL) {
+        return err;
+    }
 
-        moves[move_count].to = dest;
-        moves[move_count].to_zone = HARBOR;
-        move_count++;
+    for (i = 0; i < move_count; i++) {
+        moves[i].to = dest;
+        moves[i].to_zone = HARBOR;
     }
 
     err = validate_moves(game, moves, move_count, 3);
     if (err != NULL) {
-        free(line);
         return err;
     }
 
     move_frigates(game, moves, move_count);
 
-    free(line);
     return NULL;
 }
 
@@ -1040,13 +857,13 @@ struct card eaton_attacks_benghazi = {
     .play = play_eaton_attacks_benghazi
 };
 
-static struct card *us_core[US_CORE_CARD_COUNT] = {
+struct card *const us_cards[US_CARD_COUNT] = {
+    /* Core cards */
     &thomas_jefferson,
     &swedish_frigates_arrive,
-    &hamets_army_created
-};
+    &hamets_army_created,
 
-static struct card *us_deck[US_DECK_SIZE] = {
+    /* Deck */
     &treaty_of_peace_and_amity,
     &assault_on_tripoli,
     /* 4 of these */
@@ -1071,85 +888,159 @@ static struct card *us_deck[US_DECK_SIZE] = {
     &marine_sharpshooters
 };
 
+#define US_CORE_MASK ((1u << US_CORE_CARD_COUNT) - 1)
+#define US_DECK_MASK (((1u << US_CARD_COUNT) - 1) & ~US_CORE_MASK)
+
 void init_game_cards(struct game_state *game)
 {
-    game->us_core_cards = us_core;
-    game->us_deck = us_deck;
-    game->us_deck_size = US_DECK_SIZE;
+    game->us_core = US_CORE_MASK;
+    game->us_deck = US_DECK_MASK;
+    game->us_hand = 0;
+    game->us_discard = 0;
 }
 
+/* Every card the US could play this turn checked in one pass, the bots, the
+ * search and the display all ask about the same cards many times over */
+uint32_t playable_cards(struct game_state *game)
+{
+    uint32_t cards = game->us_hand | game->us_core;
+    uint32_t playable = 0;
+    int id;
+
+    if (game->playable_valid) {
+        return game->playable;
+    }
+
+    while (cards != 0) {
+        id = __builtin_ctz(cards);
+        cards &= cards - 1;
+        if (us_cards[id]->playable(game)) {
+            playable |= 1u << id;
+        }
+    }
+
+    game->playable = playable;
+    game->playable_valid = true;
+    return playable;
+}
+
+/* Cards outside the hand and the core cards aren't cached, they're only asked
+ * about when taking one from the discard pile or showing it */
+bool card_playable(struct game_state *game, int id)
+{
+    assert(id >= 0 && id < US_CARD_COUNT);
+
+    if ((game->us_hand | game->us_core) & (1u << id)) {
+        return (playable_cards(game) & (1u << id)) != 0;
+    }
+
+    return us_cards[id]->playable(game);
+}
+
+/* The whole draw is worked out on copies of the piles and written back once,
+ * so the hash is only updated for the bytes that end up changed */
 void draw_from_deck(struct game_state *game, int draw_count)
 {
+    uint32_t deck = game->us_deck;
+    uint32_t drawn = 0;
+    int left = deck_size(game);
     int i;
-    int rand_card;
+    int id;
 
-    assert(game->us_deck_size >= draw_count);
+    assert(left >= draw_count);
 
     for (i = 0; i < draw_count; i++) {
-        rand_card = rand() % game->us_deck_size;
-        game->us_hand[game->hand_size++] = game->us_deck[rand_card];
-        game->us_deck[rand_card] = game->us_deck[game->us_deck_size - 1];
-        game->us_deck[game->us_deck_size - 1] = NULL;
-        game->us_deck_size--;
+        id = mask_nth(deck, rng_range(&game->rng, left--));
+        deck &= ~(1u << id);
+        drawn |= 1u << id;
     }
+
+    game_set(game, game->us_deck, deck);
+    game_set(game, game->us_hand, game->us_hand | drawn);
 }
 
 void discard_from_hand(struct game_state *game, int idx)
 {
-    int i;
+    int id = mask_nth(game->us_hand, idx);
 
-    game->us_discard[game->discard_size++] = game->us_hand[idx];
-    for (i = idx; i < game->hand_size - 1; i++) {
-        game->us_hand[i] = game->us_hand[i + 1];
-    }
-    game->us_hand[--game->hand_size] = NULL;
+    game_set(game, game->us_hand, game->us_hand & ~(1u << id));
+    game_set(game, game->us_discard, game->us_discard | 1u << id);
 }
 
+/* Anything left in the deck is out of the game, the discard pile becomes the
+ * whole deck */
 void shuffle_discard_into_deck(struct game_state *game)
 {
-    memcpy(game->us_deck, game->us_discard,
-           sizeof(struct card *) * game->discard_size);
-    memset(game->us_discard, 0, sizeof(struct card *) * US_DECK_SIZE);
-    game->us_deck_size = game->discard_size;
-    game->discard_size = 0;
+    game_set(game, game->us_deck, game->us_discard);
+    game_set(game, game->us_discard, 0);
 }
 
-const char *play_card_from_hand(struct game_state *game, int idx)
+/* The card's event, or for a card that only moves frigates the moves given
+ * instead of asking game->player for them when moves isn't NULL */
+static const char *play_event(struct game_state *game, struct card *card,
+                              struct frigate_move *moves, int num_moves)
+{
+    const char *err;
+
+    if (moves == NULL) {
+        return card->play(game);
+    }
+
+    if (card->frigate_moves == 0) {
+        return "Card doesn't move frigates";
+    }
+    err = validate_moves(game, moves, num_moves, card->frigate_moves);
+    if (err != NULL) {
+        return err;
+    }
+    move_frigates(game, moves, num_moves);
+
+    return NULL;
+}
+
+static const char *play_hand_card(struct game_state *game, int idx,
+                                  struct frigate_move *moves, int num_moves)
 {
     struct card *card;
+    int id;
     const char *err;
 
-    if (idx >= game->hand_size || idx < 0) {
+    if (idx >= hand_size(game) || idx < 0) {
         return "Invalid card number";
     }
 
-    card = game->us_hand[idx];
-
-    assert(card != NULL);
+    /* Go by id from here on, playing the card can change the rest of the
+     * hand */
+    id = mask_nth(game->us_hand, idx);
+    card = us_cards[id];
 
-    if (!card->playable(game)) {
+    if (!card_playable(game, id)) {
         return "Card not playable";
     }
 
     assert(card->play);
 
-    err = card->play(game);
+    err = play_event(game, card, moves, num_moves);
     if (err != NULL) {
         return err;
     }
 
-    if (card->remove_after_use) {
-        remove_card_from_game(game, idx);
-    } else {
-        discard_from_hand(game, idx);
+    game_set(game, game->us_hand, game->us_hand & ~(1u << id));
+    if (!card->remove_after_use) {
+        game_set(game, game->us_discard, game->us_discard | 1u << id);
     }
 
     return NULL;
 }
 
-const char *play_core_card(struct game_state *game, int idx)
+const char *play_card_from_hand(struct game_state *game, int idx)
+{
+    return play_hand_card(game, idx, NULL, 0);
+}
+
+static const char *play_core(struct game_state *game, int idx,
+                             struct frigate_move *moves, int num_moves)
 {
-    int i;
     struct card *card;
     const char *err;
 
@@ -1157,23 +1048,41 @@ const char *play_core_card(struct game_state *game, int idx)
         return "Invalid card number";
     }
 
-    card = game->us_core_cards[idx];
+    card = core_card(game, idx);
 
-    if (card == NULL || !card->playable(game)) {
+    if (card == NULL || !core_card_playable(game, idx)) {
         return "Card not playable";
     }
 
     assert(card->play);
 
-    err = card->play(game);
+    err = play_event(game, card, moves, num_moves);
     if (err != NULL) {
         return err;
     }
 
-    for (i = idx; i < US_CORE_CARD_COUNT - 1; i++) {
-        game->us_core_cards[i] = game->us_core_cards[i + 1];
-    }
-    game->us_core_cards[US_CORE_CARD_COUNT - 1] = NULL;
+    game_set(game, game->us_core,
+             game->us_core & ~(1u << mask_nth(game->us_core, idx)));
 
     return NULL;
 }
+
+const char *play_core_card(struct game_state *game, int idx)
+{
+    return play_core(game, idx, NULL, 0);
+}
+
+/* Plays a hand or core card that only moves frigates with the moves given,
+ * see struct card */
+const char *play_card_moves(struct game_state *game, enum us_action type,
+                            int idx, struct frigate_move *moves,
+                            int num_moves)
+{
+    assert(type == US_PLAY_CARD || type == US_PLAY_CORE);
+    assert(moves != NULL);
+
+    if (type == US_PLAY_CARD) {
+        return play_hand_card(game, idx, moves, num_moves);
+    }
+    return play_core(game, idx, moves, num_moves);
+}
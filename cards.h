@@ -3,7 +3,7 @@
 
 #include <stdbool.h>
 
-struct game_state;
+#include "game.h"
 
 typedef bool (*playable_fn)(struct game_state *game);
 typedef const char* (*play_fn)(struct game_state *game);
@@ -15,6 +15,10 @@ struct card {
     bool battle_card;
     playable_fn playable;
     play_fn play;
+    /* Frigates moved by a card whose whole event is moving them, 0 for every
+     * other card. Search plays these with moves of its own, see
+     * play_card_moves() */
+    int frigate_moves;
 };
 
 static inline bool always_playable(struct game_state *game)
@@ -27,6 +31,50 @@ extern struct card lieutenant_in_pursuit;
 extern struct card prebles_boys;
 extern struct card lieutenant_leads_the_charge;
 extern struct card marine_sharpshooters;
+extern struct card send_in_the_marines;
+
+/* The card that starts the endgame, see assault.h */
+extern struct card assault_on_tripoli;
+
+/* Every US card with the core cards first, a card's id is its index */
+#define US_CARD_COUNT (US_CORE_CARD_COUNT + US_DECK_SIZE)
+extern struct card *const us_cards[US_CARD_COUNT];
+
+static inline struct card *hand_card(struct game_state *game, int idx)
+{
+    return us_cards[mask_nth(game->us_hand, idx)];
+}
+
+static inline struct card *discard_card(struct game_state *game, int idx)
+{
+    return us_cards[mask_nth(game->us_discard, idx)];
+}
+
+/* NULL once there are fewer than idx + 1 core cards left */
+static inline struct card *core_card(struct game_state *game, int idx)
+{
+    if (idx >= mask_count(game->us_core)) {
+        return NULL;
+    }
+    return us_cards[mask_nth(game->us_core, idx)];
+}
+
+uint32_t playable_cards(struct game_state *game);
+bool card_playable(struct game_state *game, int id);
+
+static inline bool hand_card_playable(struct game_state *game, int idx)
+{
+    return card_playable(game, mask_nth(game->us_hand, idx));
+}
+
+/* False once there are fewer than idx + 1 core cards left */
+static inline bool core_card_playable(struct game_state *game, int idx)
+{
+    if (idx >= mask_count(game->us_core)) {
+        return false;
+    }
+    return card_playable(game, mask_nth(game->us_core, idx));
+}
 
 void init_game_cards(struct game_state *game);
 void draw_from_deck(struct game_state *game, int draw_count);
@@ -35,6 +83,10 @@ void shuffle_discard_into_deck(struct game_state *game);
 void remove_card_from_game(struct game_state *game, int idx);
 const char *play_card_from_hand(struct game_state *game, int idx);
 const char *play_core_card(struct game_state *game, int idx);
+const char *play_card_moves(struct game_state *game, enum us_action type,
+                            int idx, struct frigate_move *moves,
+                            int num_moves);
+int card_in_hand(struct game_state *game, struct card *card);
 bool check_play_battle_card(struct game_state *game, struct card *card);
 
 #endif /* CARDS_H */
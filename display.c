@@ -1,3 +1,4 @@
+#include <inttypes.h>
 #include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
@@ -82,7 +83,9 @@ static void print_harbor(struct game_state *game, enum locations location)
 
 static void print_tbot_log(struct game_state *game)
 {
-    cprintf(ITALIC RED, "%s", game->tbot_log);
+    if (game->log != NULL) {
+        cprintf(ITALIC RED, "%s", game->log->text);
+    }
 }
 
 static void print_patrol_zone(struct game_state *game, enum locations location)
@@ -128,7 +131,7 @@ static void print_locations(struct game_state *game)
     }
 }
 
-static void print_card(struct game_state *game, struct card *card, int idx)
+static void print_card(struct card *card, int idx, bool playable)
 {
     const char *remove = "";
 
@@ -140,7 +143,7 @@ static void print_card(struct game_state *game, struct card *card, int idx)
             "the game.";
     }
 
-    if (card->playable(game)) {
+    if (playable) {
         cprintf(BOLD, "%d) [%s]", idx, card->name);
     } else {
         if (card->battle_card) {
@@ -158,8 +161,8 @@ static void print_hand(struct game_state *game)
 
     cprintf(BOLD BLUE, "[ Hand ]\n");
 
-    for (i = 0; i < game->hand_size; i++) {
-        print_card(game, game->us_hand[i], i);
+    for (i = 0; i < hand_size(game); i++) {
+        print_card(hand_card(game, i), i, hand_card_playable(game, i));
     }
 }
 
@@ -167,18 +170,14 @@ static void print_core_cards(struct game_state *game)
 {
     int i;
 
-    if (game->us_core_cards[0] == NULL) {
+    if (game->us_core == 0) {
         return;
     }
 
     cprintf(BOLD BLUE, "[ Core Cards ]\n");
 
-    for (i = 0; i < US_CORE_CARD_COUNT; i++) {
-        if (game->us_core_cards[i]) {
-            print_card(game, game->us_core_cards[i], i);
-        } else {
-            break;
-        }
+    for (i = 0; i < mask_count(game->us_core); i++) {
+        print_card(core_card(game, i), i, core_card_playable(game, i));
     }
 }
 
@@ -188,8 +187,9 @@ void print_discard_pile(struct game_state *game)
 
     cprintf(BOLD BLUE, "[ Discard Pile ]\n");
 
-    for (i = 0; i < game->discard_size; i++) {
-        print_card(game, game->us_discard[i], i);
+    for (i = 0; i < discard_size(game); i++) {
+        print_card(discard_card(game, i), i,
+                   card_playable(game, mask_nth(game->us_discard, i)));
     }
 }
 
@@ -254,11 +254,40 @@ static void print_year_track(struct game_state *game)
     cprintf(BOLD WHITE, " ] ");
 }
 
+void print_game_result(struct game_state *game)
+{
+    switch (game->result) {
+        case GAME_DRAW:
+            cprintf(ITALIC WHITE, "Game ended in a draw!\n");
+            break;
+        case TRIPOLI_GOLD_WIN:
+        case TRIPOLI_FRIGATES_WIN:
+            cprintf(ITALIC RED, "The tripolitan pirates have won!\n");
+            break;
+        case US_TREATY_WIN:
+            cprintf(ITALIC BLUE, "US Victory via Peace Treaty!\n");
+            break;
+        case US_ASSAULT_WIN:
+            cprintf(ITALIC BLUE, "US Victory via Assault on Tripoli!\n");
+            break;
+        case US_ASSAULT_FAILED:
+            cprintf(ITALIC RED, "The assault on Tripoli has failed! "
+                    "The tripolitan pirates have claimed victory\n");
+            break;
+        default:
+            assert(false);
+    }
+}
+
 void display_game(struct game_state *game)
 {
     struct winsize size;
     int ret;
 
+    if (game->headless) {
+        return;
+    }
+
     ret = ioctl(STDOUT_FILENO, TIOCGWINSZ, &size);
     assert(ret == 0);
 
@@ -272,7 +301,7 @@ void display_game(struct game_state *game)
             game->destroyed_us_frigates, DESTROYED_FRIGATES_WIN);
     cprintf(BOLD YELLOW, "[ Tripolitan Gold : %u/%u ] ", game->pirated_gold,
             GOLD_WIN);
-    cprintf(BOLD MAGENTA, "[ Game Seed : %u ]\n", game->seed);
+    cprintf(BOLD MAGENTA, "[ Game Seed : %" PRIu64 " ]\n", game->seed);
 
     print_separator(size.ws_col);
     print_locations(game);
@@ -39,6 +39,7 @@ static inline void clear_screen()
 }
 
 void display_game(struct game_state *game);
+void print_game_result(struct game_state *game);
 void print_discard_pile(struct game_state *game);
 
 #endif /* DISPLAY_H */
@@ -7,9 +7,11 @@
 #include "display.h"
 #include "game.h"
 #include "input.h"
+#include "odds.h"
+#include "player.h"
 #include "tbot.h"
 
-void init_game_state(struct game_state *game, unsigned int seed)
+void init_game_state(struct game_state *game, uint64_t seed)
 {
     unsigned int year;
     unsigned int i;
@@ -18,10 +20,9 @@ void init_game_state(struct game_state *game, unsigned int seed)
         seed = time(NULL);
     }
 
-    srand(seed);
-
     memset(game, 0, sizeof(*game));
     game->seed = seed;
+    rng_seed(&game->rng, seed);
 
     game->year = START_YEAR;
     game->season = SPRING;
@@ -40,7 +41,54 @@ void init_game_state(struct game_state *game, unsigned int seed)
     /* No active battle */
     game->gunboat_loc = INVALID_LOCATION;
 
+    game->player = &terminal_player;
+
     init_game_cards(game);
+    tbot_init(game);
+    update_battles(game, (1u << NUM_LOCATIONS) - 1);
+
+    game->hash = game_compute_hash(game);
+}
+
+/* From scratch, game->hash should always match this */
+uint64_t game_compute_hash(const struct game_state *game)
+{
+    const unsigned char *state = (const unsigned char *)game;
+    uint64_t hash = 0;
+    size_t i;
+
+    for (i = GAME_HASH_START; i < GAME_HOT_SIZE; i++) {
+        hash ^= zobrist_key(i, state[i]);
+    }
+
+    return hash;
+}
+
+/* Hits from count dice that each hit on success or better. The number of hits
+ * is drawn all at once from the binomial chances, one draw for the whole
+ * pool however many dice there are. Pools too big for the tables are rolled
+ * as several smaller pools */
+unsigned int rolld6s(struct game_state *game, int count, int success)
+{
+    const uint64_t *cdf;
+    uint64_t draw;
+    unsigned int hits = 0;
+    int dice, i;
+
+    assert(count >= 0);
+
+    while (count > 0) {
+        dice = min(count, ODDS_MAX_DICE);
+        count -= dice;
+
+        cdf = odds_cdf(dice, success);
+        draw = rng_next(&game->rng);
+        for (i = 0; i < dice && draw >= cdf[i]; i++) {
+        }
+        hits += i;
+    }
+
+    return hits;
 }
 
 bool game_handle_intercept(struct game_state *game, enum locations location)
@@ -49,7 +97,7 @@ bool game_handle_intercept(struct game_state *game, enum locations location)
     bool lieutenant_played = false;
     int rolls = 0;
     int successes = 0;
-    unsigned int *corsairs;
+    uint8_t *corsairs;
     /* Used for signal books overboard check by tbot */
     bool intercepted = false;
 
@@ -79,7 +127,7 @@ bool game_handle_intercept(struct game_state *game, enum locations location)
         rolls += FRIGATE_DICE * game->patrol_frigates[location];
     }
 
-    successes = rolld6s(rolls, 6);
+    successes = rolld6s(game, rolls, 6);
 
     if (has_trip_allies(location)) {
         corsairs = &game->t_allies[location];
@@ -90,40 +138,72 @@ bool game_handle_intercept(struct game_state *game, enum locations location)
     }
 
     if (successes > *corsairs) {
-        *corsairs = 0;
+        game_set(game, *corsairs, 0);
     } else {
-        *corsairs -= successes;
+        game_sub(game, *corsairs, successes);
     }
 
     return intercepted;
 }
 
-static void advance_game_round(struct game_state *game)
+static enum game_result advance_game_round(struct game_state *game)
 {
     unsigned int frig_idx;
 
     if (game_draw(game)) {
-        cprintf(ITALIC WHITE, "Game ended in a draw!\n");
-        exit(EXIT_SUCCESS);
+        return game_over(game, GAME_DRAW);
     }
 
     if (game->season == WINTER) {
-        game->year++;
-        game->season = SPRING;
+        game_add(game, game->year, 1);
+        game_set(game, game->season, SPRING);
 
         frig_idx = year_to_frigate_idx(game->year);
-        game->us_frigates[GIBRALTAR] += game->turn_track_frigates[frig_idx];
-        game->turn_track_frigates[frig_idx] = 0;
+        game_add(game, game->us_frigates[GIBRALTAR],
+                 game->turn_track_frigates[frig_idx]);
+        game_set(game, game->turn_track_frigates[frig_idx], 0);
 
-        game->t_frigates += game->t_turn_frigates[frig_idx];
-        game->t_turn_frigates[frig_idx] = 0;
+        game_add(game, game->t_frigates, game->t_turn_frigates[frig_idx]);
+        game_set(game, game->t_turn_frigates[frig_idx], 0);
     } else {
-        game->season++;
+        game_add(game, game->season, 1);
     }
+
+    return GAME_IN_PROGRESS;
 }
 
-enum battle_type location_battle(struct game_state *game,
-                                 enum locations location)
+#define BATTLE_FIELD(field, location) \
+    [offsetof(struct game_state, field)] = 1u << (location)
+
+const uint16_t battle_fields[GAME_HOT_SIZE] = {
+    BATTLE_FIELD(t_frigates, TRIPOLI),
+    BATTLE_FIELD(t_corsairs_tripoli, TRIPOLI),
+    BATTLE_FIELD(t_allies[TANGIER], TANGIER),
+    BATTLE_FIELD(t_allies[ALGIERS], ALGIERS),
+    BATTLE_FIELD(t_allies[TUNIS], TUNIS),
+    BATTLE_FIELD(t_infantry[TRIPOLI - TRIP_INFANTRY_START], TRIPOLI),
+    BATTLE_FIELD(t_infantry[BENGHAZI - TRIP_INFANTRY_START], BENGHAZI),
+    BATTLE_FIELD(t_infantry[DERNE - TRIP_INFANTRY_START], DERNE),
+    BATTLE_FIELD(arab_infantry[TRIPOLI - US_INFANTRY_START], TRIPOLI),
+    BATTLE_FIELD(arab_infantry[BENGHAZI - US_INFANTRY_START], BENGHAZI),
+    BATTLE_FIELD(arab_infantry[DERNE - US_INFANTRY_START], DERNE),
+    BATTLE_FIELD(arab_infantry[ALEXANDRIA - US_INFANTRY_START], ALEXANDRIA),
+    BATTLE_FIELD(marine_infantry[TRIPOLI - US_INFANTRY_START], TRIPOLI),
+    BATTLE_FIELD(marine_infantry[BENGHAZI - US_INFANTRY_START], BENGHAZI),
+    BATTLE_FIELD(marine_infantry[DERNE - US_INFANTRY_START], DERNE),
+    BATTLE_FIELD(marine_infantry[ALEXANDRIA - US_INFANTRY_START], ALEXANDRIA),
+    BATTLE_FIELD(us_frigates[TANGIER], TANGIER),
+    BATTLE_FIELD(us_frigates[ALGIERS], ALGIERS),
+    BATTLE_FIELD(us_frigates[TUNIS], TUNIS),
+    BATTLE_FIELD(us_frigates[TRIPOLI], TRIPOLI),
+    BATTLE_FIELD(us_frigates[BENGHAZI], BENGHAZI),
+    BATTLE_FIELD(us_frigates[DERNE], DERNE),
+    BATTLE_FIELD(us_frigates[ALEXANDRIA], ALEXANDRIA),
+    BATTLE_FIELD(us_frigates[MALTA], MALTA),
+};
+
+static enum battle_type find_battle(struct game_state *game,
+                                    enum locations location)
 {
     int idx;
     bool us_frigates = game->us_frigates[location] > 0;
@@ -136,7 +216,7 @@ enum battle_type location_battle(struct game_state *game,
 
     /* Never any fighting in Gibraltar */
     if (location == GIBRALTAR) {
-        return false;
+        return BTYPE_NONE;
     }
 
     if (has_us_infantry(location)) {
@@ -176,6 +256,24 @@ enum battle_type location_battle(struct game_state *game,
     return BTYPE_NONE;
 }
 
+/* Works out the battle again at each location in the mask, called by
+ * game_write() for every change to a field in battle_fields */
+void update_battles(struct game_state *game, uint16_t locations)
+{
+    uint32_t battles = game->battles;
+    int shift;
+
+    while (locations != 0) {
+        shift = __builtin_ctz(locations) * BATTLE_BITS;
+        locations &= locations - 1;
+
+        battles &= ~(BATTLE_MASK << shift);
+        battles |= (uint32_t)find_battle(game, shift / BATTLE_BITS) << shift;
+    }
+
+    game_set(game, game->battles, battles);
+}
+
 void move_frigates(struct game_state *game, struct frigate_move *moves,
                    int num_moves)
 {
@@ -185,15 +283,15 @@ void move_frigates(struct game_state *game, struct frigate_move *moves,
     for (i = 0; i < num_moves; i++) {
         move = &moves[i];
         if (move->from_zone == HARBOR) {
-            game->us_frigates[move->from] -= move->quantity;
+            game_sub(game, game->us_frigates[move->from], move->quantity);
         } else {
-            game->patrol_frigates[move->from] -= move->quantity;
+            game_sub(game, game->patrol_frigates[move->from], move->quantity);
         }
 
         if (move->to_zone == HARBOR) {
-            game->us_frigates[move->to] += move->quantity;
+            game_add(game, game->us_frigates[move->to], move->quantity);
         } else {
-            game->patrol_frigates[move->to] += move->quantity;
+            game_add(game, game->patrol_frigates[move->to], move->quantity);
         }
     }
 }
@@ -205,11 +303,19 @@ const char *validate_moves(struct game_state *game,
     int i;
     struct frigate_move *move;
     int count = 0;
+    int slot;
+    unsigned int frigates[FRIGATE_SLOTS];
 
     if (num_moves > allowed_moves) {
         return "Too many moves";
     }
 
+    /* move_frigates() goes one move at a time so check each move against
+     * what the moves before it left behind */
+    for (slot = 0; slot < FRIGATE_SLOTS; slot++) {
+        frigates[slot] = *slot_frigates(game, slot);
+    }
+
     for (i = 0; i < num_moves; i++) {
         move = &moves[i];
 
@@ -221,23 +327,17 @@ const char *validate_moves(struct game_state *game,
             return "Invalid move type";
         }
 
-        if (move->from_zone == HARBOR &&
-            game->us_frigates[move->from] < move->quantity) {
-            return "Invalid move quantity";
-        }
-
-        if (move->from_zone == PATROL_ZONE) {
-            if (!has_patrol_zone(move->from)) {
-                return "Move location does not have a patrol zone";
-            }
-            if (game->patrol_frigates[move->from] < move->quantity) {
-                return "Invalid move quantity";
-            }
+        if ((move->from_zone == PATROL_ZONE && !has_patrol_zone(move->from)) ||
+            (move->to_zone == PATROL_ZONE && !has_patrol_zone(move->to))) {
+            return "Move location does not have a patrol zone";
         }
 
-        if (move->to_zone == PATROL_ZONE && !has_patrol_zone(move->to)) {
-            return "Move location does not have a patrol zone";
+        slot = frigate_slot(move->from, move->from_zone);
+        if (frigates[slot] < move->quantity) {
+            return "Invalid move quantity";
         }
+        frigates[slot] -= move->quantity;
+        frigates[frigate_slot(move->to, move->to_zone)] += move->quantity;
 
         count += move->quantity;
         if (count > allowed_moves) {
@@ -254,7 +354,7 @@ const char *game_move_ships(struct game_state *game, int allowed_moves)
     int num_moves;
     const char *err;
 
-    err = parse_moves(moves, &num_moves, allowed_moves);
+    err = game->player->move_frigates(game, allowed_moves, moves, &num_moves);
     if (err) {
         return err;
     }
@@ -277,68 +377,170 @@ static bool can_build_gunboat(struct game_state *game)
 bool build_gunboat(struct game_state *game)
 {
     if (can_build_gunboat(game)) {
-        game->us_gunboats++;
+        game_add(game, game->us_gunboats, 1);
         return true;
     }
 
     return false;
 }
 
+/* Discarding to build or move only happens once the build or move goes
+ * through so a rejected move keeps the card in hand */
+const char *game_take_action(struct game_state *game, enum us_action action,
+                             int idx)
+{
+    const char *err;
+    int i;
+
+    switch (action) {
+        case US_PASS:
+            /* Only once there's nothing left to do with the turn */
+            if (game->us_hand != 0) {
+                return "Cards left in hand";
+            }
+            for (i = 0; i < mask_count(game->us_core); i++) {
+                if (core_card_playable(game, i)) {
+                    return "Core cards left to play";
+                }
+            }
+            return NULL;
+        case US_PLAY_CARD:
+            return play_card_from_hand(game, idx);
+        case US_PLAY_CORE:
+            return play_core_card(game, idx);
+        case US_BUILD_GUNBOAT:
+        case US_MOVE_FRIGATES:
+            if (idx < 0 || idx >= hand_size(game)) {
+                return "Invalid card index";
+            }
+            if (action == US_BUILD_GUNBOAT) {
+                if (!build_gunboat(game)) {
+                    return "Cannot build any more gunboats";
+                }
+            } else {
+                err = game_move_ships(game, 2);
+                if (err) {
+                    return err;
+                }
+            }
+            discard_from_hand(game, idx);
+            return NULL;
+    }
+
+    return "Invalid action";
+}
+
 static void game_draw_cards(struct game_state *game)
 {
     int draw_count = 6;
 
     if (game->year == 1806) {
-        draw_count = game->us_deck_size;
+        draw_count = deck_size(game);
     }
 
     if (game->year == 1805) {
         shuffle_discard_into_deck(game);
     }
 
-    draw_from_deck(game, draw_count);
+    /* Cards removed from the game can leave less than a full draw */
+    draw_from_deck(game, min(draw_count, deck_size(game)));
 }
 
 static const char *discard_down(struct game_state *game)
 {
-    char *line;
     int idx;
+    const char *err;
 
-    cprintf(BOLD ITALIC RED, "Too many cards in hand choose a card to "
-            "discard\n");
-    prompt();
+    err = game->player->discard_down(game, &idx);
+    if (err) {
+        return err;
+    }
 
-    line = input_getline();
-    if (!game_strtol(line, &idx) || idx < 0 || idx >= game->hand_size) {
-        free(line);
+    if (idx < 0 || idx >= hand_size(game)) {
         return "Invalid card number";
     }
 
     discard_from_hand(game, idx);
 
-    free(line);
     return NULL;
 }
 
-static bool battles_to_handle(struct game_state *game)
+static void print_err_msg(struct game_state *game)
 {
-    int i;
+    if (game->error != NULL && !game->headless) {
+        cprintf(UNDERLINE BOLD RED, "%s\n", game->error);
+    }
+}
 
-    for (i = 0; i < NUM_LOCATIONS; i++) {
-        if (location_battle(game, i) != BTYPE_NONE) {
-            return true;
-        }
+static const char *assign_gunboats(struct game_state *game,
+                                   enum locations location, enum zone zone)
+{
+    int gunboats;
+    const char *err;
+
+    /* No boats to assign */
+    if (game->used_gunboats == game->us_gunboats) {
+        return NULL;
     }
 
-    return false;
+    err = game->player->assign_gunboats(game, location, zone, &gunboats);
+    if (err) {
+        return err;
+    }
+
+    if (gunboats < 0) {
+        return "Invalid number provided";
+    }
+
+    if (gunboats > (game->us_gunboats - game->used_gunboats)) {
+        return "Too many gunboats chosen";
+    }
+
+    game_set(game, game->assigned_gunboats, gunboats);
+    game_add(game, game->used_gunboats, gunboats);
+
+    return NULL;
+}
+
+static const char *assign_damage(struct game_state *game,
+                                 enum locations location, enum zone zone,
+                                 int num_hits, enum battle_type btype)
+{
+    struct damage_assignment damage = { 0 };
+    const char *err;
+
+    assert(btype == NAVAL_BATTLE || btype == GROUND_BATTLE);
+
+    if (num_hits == 0) {
+        return NULL;
+    }
+
+    if (try_auto_assign_damage(game, location, zone, num_hits, btype)) {
+        return NULL;
+    }
+
+    err = game->player->assign_damage(game, location, zone, num_hits, btype,
+                                      &damage);
+    if (err) {
+        return err;
+    }
+
+    if (btype == NAVAL_BATTLE) {
+        return assign_naval_damage(game, location, zone, num_hits,
+                                   damage.destroy_frigates,
+                                   damage.damage_frigates,
+                                   damage.destroy_gunboats);
+    }
+    return assign_ground_damage(game, location, num_hits,
+                                damage.destroy_marines, damage.destroy_arabs);
 }
 
 static void return_to_malta(struct game_state *game,
                             enum locations location)
 {
-    game->us_frigates[MALTA] += game->us_frigates[location];
-    game->us_frigates[location] = 0;
-    game->assigned_gunboats = 0;
+    game_add(game, game->us_frigates[MALTA], game->us_frigates[location]);
+    game_set(game, game->us_frigates[location], 0);
+    game_set(game, game->assigned_gunboats, 0);
 }
 
 static const char *resolve_naval_battle(struct game_state *game,
@@ -350,7 +552,7 @@ static const char *resolve_naval_battle(struct game_state *game,
     int damage;
     const char *err;
 
-    err = parse_assign_gunboats(game, location, HARBOR);
+    err = assign_gunboats(game, location, HARBOR);
     if (err != NULL) {
         return err;
     }
@@ -364,14 +566,14 @@ static const char *resolve_naval_battle(struct game_state *game,
     }
 
     dice += game->assigned_gunboats;
-    successes = rolld6s(dice, 6);
+    successes = rolld6s(game, dice, 6);
 
     damage = tbot_resolve_naval_battle(game, location, successes);
     display_game(game); /* After resolving the bot battle turn refresh the
                          * display */
-    while ((err = parse_damage_assignment(game, location, HARBOR, damage,
-                                          NAVAL_BATTLE))) {
-        cprintf(BOLD RED, "%s\n", err);
+    while ((game->error = assign_damage(game, location, HARBOR, damage,
+                                        NAVAL_BATTLE))) {
+        print_err_msg(game);
     }
 
     if (!game->victory_or_death) {
@@ -391,21 +593,21 @@ static const char *resolve_naval_bombardment(struct game_state *game,
 
     assert(has_trip_infantry(location));
 
-    err = parse_assign_gunboats(game, location, HARBOR);
+    err = assign_gunboats(game, location, HARBOR);
     if (err) {
         return err;
     }
 
     dice += game->assigned_gunboats;
-    successes = rolld6s(dice, 6);
+    successes = rolld6s(game, dice, 6);
 
     /* We just handle the damage for the tbot since there's only one way to
      * assign it */
     idx = trip_infantry_idx(location);
     if (successes > game->t_infantry[idx]) {
-        game->t_infantry[idx] = 0;
+        game_set(game, game->t_infantry[idx], 0);
     } else {
-        game->t_infantry[idx] -= successes;
+        game_sub(game, game->t_infantry[idx], successes);
     }
 
     /* Even in the assault on tripoli we want to send them back as there's only
@@ -422,7 +624,6 @@ static const char *resolve_ground_combat(struct game_state *game,
     int successes;
     int dice;
     int damage;
-    const char *err;
     enum battle_type btype;
     bool lieutenant_played;
     bool sharpshooters_played;
@@ -451,17 +652,17 @@ static const char *resolve_ground_combat(struct game_state *game,
             dice += 2;
         }
 
-        successes = rolld6s(dice, (sharpshooters_played) ? 5 : 6);
+        successes = rolld6s(game, dice, (sharpshooters_played) ? 5 : 6);
 
         dice = game->arab_infantry[idx];
-        successes += rolld6s(dice, 6);
+        successes += rolld6s(game, dice, 6);
 
         damage = tbot_resolve_ground_combat(game, location, successes);
         display_game(game);
 
-        while ((err = parse_damage_assignment(game, location, HARBOR, damage,
-                                              GROUND_BATTLE))) {
-            cprintf(BOLD RED, "%s\n", err);
+        while ((game->error = assign_damage(game, location, HARBOR, damage,
+                                            GROUND_BATTLE))) {
+            print_err_msg(game);
         }
 
         btype = location_battle(game, location);
@@ -489,9 +690,9 @@ static const char *resolve_battle(struct game_state *game,
     }
 
     if (btype != GROUND_BATTLE) {
-        game->gunboat_loc = battle_loc;
+        game_set(game, game->gunboat_loc, battle_loc);
     } else {
-        game->gunboat_loc = INVALID_LOCATION;
+        game_set(game, game->gunboat_loc, INVALID_LOCATION);
     }
 
     switch (btype) {
@@ -510,93 +711,129 @@ static const char *resolve_battle(struct game_state *game,
 
 static const char *handle_battles(struct game_state *game)
 {
-    char *line;
     enum locations battle_loc;
+    const char *err;
 
     if (game->victory_or_death) {
         return resolve_battle(game, TRIPOLI);
     }
 
-    cprintf(BOLD WHITE, "Enter a location to resolve a battle at: ");
-    line = input_getline();
-    battle_loc = parse_location(line);
+    err = game->player->choose_battle(game, &battle_loc);
+    if (err) {
+        return err;
+    }
 
-    free(line);
     return resolve_battle(game, battle_loc);
 }
 
-static inline void print_err_msg(const char *err_msg)
+static enum game_result check_tripoli_win(struct game_state *game)
 {
-    if (err_msg != NULL) {
-        cprintf(UNDERLINE BOLD RED, "%s\n", err_msg);
+    if (game->pirated_gold >= GOLD_WIN) {
+        return game_over(game, TRIPOLI_GOLD_WIN);
+    }
+    if (game->destroyed_us_frigates >= DESTROYED_FRIGATES_WIN) {
+        return game_over(game, TRIPOLI_FRIGATES_WIN);
     }
+
+    return GAME_IN_PROGRESS;
 }
 
-static void check_tripoli_win(struct game_state *game)
+/* Records how the game ended, anything that can end the game passes the result
+ * back up to game_loop() which stops as soon as it is set */
+enum game_result game_over(struct game_state *game, enum game_result result)
 {
-    if (tripolitan_win(game)) {
-        display_game(game); /* Re-render the window to show wincons */
-        cprintf(ITALIC RED, "The tripolitan pirates have won!\n");
-        exit(EXIT_SUCCESS);
-    }
+    assert(result != GAME_IN_PROGRESS);
+    assert(game->result == GAME_IN_PROGRESS);
+
+    game_set(game, game->result, result);
+    return result;
 }
 
-void game_loop(struct game_state *game)
+/* Runs one phase of the turn, or one attempt at it when the US player has to
+ * try again, and leaves game->phase at wherever play picks up next */
+enum game_result game_step(struct game_state *game)
 {
-    const char *err_msg = NULL;
-
-    while (true) {
-        if (game->season == SPRING) {
-            game_draw_cards(game);
-        }
+    switch (game->phase) {
+        case PHASE_DRAW:
+            if (game->season == SPRING) {
+                game_draw_cards(game);
+            }
+            game_set(game, game->phase, PHASE_US_TURN);
+            break;
+        case PHASE_US_TURN:
+            display_game(game);
+            print_err_msg(game);
 
-    display:
-        display_game(game);
-        print_err_msg(err_msg);
+            if (hand_size(game) > MAX_HAND_SIZE) {
+                game->error = discard_down(game);
+                break;
+            }
 
-        if (game->hand_size > MAX_HAND_SIZE) {
-            err_msg = discard_down(game);
-            goto display;
-        }
+            /* Search left a card's moves half done, the player makes the
+             * rest */
+            if (game->us_moves_left > 0) {
+                game->error = game_move_ships(game, game->us_moves_left);
+                if (game->error == NULL) {
+                    game_set(game, game->us_moves_left, 0);
+                    game_set(game, game->phase, PHASE_BATTLES);
+                }
+                break;
+            }
 
-        err_msg = handle_input(game);
-        if (err_msg) {
-            goto display;
-        }
+            game->error = game->player->take_turn(game);
+            if (game->error == NULL) {
+                game_set(game, game->phase, PHASE_BATTLES);
+            }
+            break;
+        case PHASE_BATTLES:
+            if (battles_pending(game)) {
+                display_game(game);
+                print_err_msg(game);
+                game->error = handle_battles(game);
+                check_tripoli_win(game);
+                break;
+            }
 
-        while (battles_to_handle(game)) {
-            display_game(game);
-            print_err_msg(err_msg);
-            err_msg = handle_battles(game);
-            check_tripoli_win(game);
-        }
-        game->gunboat_loc = INVALID_LOCATION;
-        game->used_gunboats = 0;
-        game->assigned_gunboats = 0;
+            game_set(game, game->gunboat_loc, INVALID_LOCATION);
+            game_set(game, game->used_gunboats, 0);
+            game_set(game, game->assigned_gunboats, 0);
 
-        if (game->victory_or_death) {
-            display_game(game);
-            if (game->t_infantry[trip_infantry_idx(TRIPOLI)] == 0) {
-                cprintf(ITALIC BLUE, "US Victory via Assault on Tripoli!\n");
-            } else {
-                cprintf(ITALIC RED, "The assault on Tripoli has failed! "
-                        "The tripolitan pirates have claimed victory\n");
+            if (game->victory_or_death) {
+                if (game->t_infantry[trip_infantry_idx(TRIPOLI)] == 0) {
+                    return game_over(game, US_ASSAULT_WIN);
+                }
+                return game_over(game, US_ASSAULT_FAILED);
             }
-            exit(EXIT_SUCCESS);
-        }
+            game_set(game, game->phase, PHASE_TRIPOLI_TURN);
+            break;
+        case PHASE_TRIPOLI_TURN:
+            tbot_do_turn(game);
+            check_tripoli_win(game);
+            game_set(game, game->phase, PHASE_ADVANCE);
+            break;
+        case PHASE_ADVANCE:
+            advance_game_round(game);
+            game_set(game, game->phase, PHASE_DRAW);
+            break;
+    }
 
-        tbot_do_turn(game);
-        check_tripoli_win(game);
+    /* Treaty of Peace and Amity ends the game as it's played */
+    return game->result;
+}
 
-        advance_game_round(game);
+enum game_result game_loop(struct game_state *game)
+{
+    while (game_step(game) == GAME_IN_PROGRESS) {
     }
+
+    return game->result;
 }
 
 static bool try_auto_assign_naval_battle(struct game_state *game,
                                          enum locations location,
                                          enum zone zone, int num_hits)
 {
-    unsigned int *frigate_ptr = us_frigate_ptr(game, location, zone);
+    uint8_t *frigate_ptr = us_frigate_ptr(game, location, zone);
     int total_hp = *frigate_ptr * 2 + game->assigned_gunboats +
         game->us_damaged_frigates;
 
@@ -604,10 +841,10 @@ static bool try_auto_assign_naval_battle(struct game_state *game,
         return false;
     }
 
-    *frigate_ptr = 0;
-    game->used_gunboats -= game->assigned_gunboats;
-    game->assigned_gunboats = 0;
-    game->us_damaged_frigates = 0;
+    game_set(game, *frigate_ptr, 0);
+    game_sub(game, game->used_gunboats, game->assigned_gunboats);
+    game_set(game, game->assigned_gunboats, 0);
+    game_set(game, game->us_damaged_frigates, 0);
 
     return true;
 }
@@ -623,8 +860,8 @@ static bool try_auto_assign_ground_battle(struct game_state *game,
         return false;
     }
 
-    game->marine_infantry[idx] = 0;
-    game->arab_infantry[idx] = 0;
+    game_set(game, game->marine_infantry[idx], 0);
+    game_set(game, game->arab_infantry[idx], 0);
 
     return true;
 }
@@ -643,7 +880,7 @@ const char *assign_naval_damage(struct game_state *game, enum locations location
                                 int destroy_frigates, int damage_frigates,
                                 int destroy_gunboats)
 {
-    unsigned int *frigate_ptr = us_frigate_ptr(game, location, zone);
+    uint8_t *frigate_ptr = us_frigate_ptr(game, location, zone);
     int rem;
 
     if (num_hits != destroy_frigates * 2 + damage_frigates + destroy_gunboats) {
@@ -660,29 +897,30 @@ const char *assign_naval_damage(struct game_state *game, enum locations location
         return "Not enough gunboats to destroy at the location";
     }
 
-    game->us_gunboats -= destroy_gunboats;
-    game->assigned_gunboats -= destroy_gunboats;
-    game->used_gunboats -= destroy_gunboats;
+    game_sub(game, game->us_gunboats, destroy_gunboats);
+    game_sub(game, game->assigned_gunboats, destroy_gunboats);
+    game_sub(game, game->used_gunboats, destroy_gunboats);
 
-    game->destroyed_us_frigates += destroy_frigates;
+    game_add(game, game->destroyed_us_frigates, destroy_frigates);
 
-    *frigate_ptr -= destroy_frigates;
+    game_sub(game, *frigate_ptr, destroy_frigates);
     if (*frigate_ptr < damage_frigates) {
         assert(game->victory_or_death);
         rem = damage_frigates - *frigate_ptr;
-        *frigate_ptr = 0;
-        game->destroyed_us_frigates += rem;
-        game->us_damaged_frigates -= rem;
+        game_set(game, *frigate_ptr, 0);
+        game_add(game, game->destroyed_us_frigates, rem);
+        game_sub(game, game->us_damaged_frigates, rem);
         damage_frigates = 0;
     } else {
-        *frigate_ptr -= damage_frigates;
+        game_sub(game, *frigate_ptr, damage_frigates);
     }
 
     if (game->victory_or_death) {
-        game->us_damaged_frigates += damage_frigates;
+        game_add(game, game->us_damaged_frigates, damage_frigates);
     } else if (game->year < END_YEAR) {
-        game->turn_track_frigates[year_to_frigate_idx(game->year + 1)] +=
-            damage_frigates;
+        game_add(game,
+                 game->turn_track_frigates[year_to_frigate_idx(game->year + 1)],
+                 damage_frigates);
     }
 
     return NULL;
@@ -706,8 +944,8 @@ const char *assign_ground_damage(struct game_state *game,
         return "Assigning more damage than arab infantry at location";
     }
 
-    game->marine_infantry[idx] -= destroy_marines;
-    game->arab_infantry[idx] -= destroy_arabs;
+    game_sub(game, game->marine_infantry[idx], destroy_marines);
+    game_sub(game, game->arab_infantry[idx], destroy_arabs);
 
     return NULL;
 }
@@ -5,9 +5,13 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "rng.h"
+
 enum locations {
     TANGIER = 0,
     ALGIERS,
@@ -50,65 +54,315 @@ enum battle_type {
 #define GUNBOAT_DICE 1
 #define CORSAIR_DICE 1
 
-struct game_state {
-    unsigned int seed;
+/* Where game_step() picks the turn back up. Decisions inside a phase are
+ * made through the player, see session.h to suspend on those */
+enum game_phase {
+    PHASE_DRAW,
+    PHASE_US_TURN,
+    PHASE_BATTLES,
+    PHASE_TRIPOLI_TURN,
+    PHASE_ADVANCE
+};
+
+/* Everything the US player can do with their turn, see game_take_action() */
+enum us_action {
+    US_PASS,
+    US_PLAY_CARD,
+    US_PLAY_CORE,
+    US_BUILD_GUNBOAT,
+    US_MOVE_FRIGATES
+};
+
+enum game_result {
+    GAME_IN_PROGRESS,
+    GAME_DRAW,
+    TRIPOLI_GOLD_WIN,
+    TRIPOLI_FRIGATES_WIN,
+    US_TREATY_WIN,
+    US_ASSAULT_WIN,
+    US_ASSAULT_FAILED,
+    NUM_GAME_RESULTS
+};
+
+struct player;
+
+/* Running commentary of the T-Bot turn for the terminal. It lives outside the
+ * game so copies of a game never drag it along, games without one skip the
+ * logging entirely */
+struct tbot_log {
+#define TBOT_LOG_LEN (2048)
+    char text[TBOT_LOG_LEN];
+    char *ptr;
+};
+
 #define START_YEAR (1801)
 #define END_YEAR (1806)
-    unsigned int year;
-    enum seasons season;
-
-    /* Tripolitan player */
-    /* Wincons */
 #define DESTROYED_FRIGATES_WIN (4)
-    unsigned int destroyed_us_frigates;
 #define GOLD_WIN (12)
-    unsigned int pirated_gold;
-    unsigned int t_frigates;
-    unsigned int t_damaged_frigates;
 #define MAX_TRIPOLI_CORSAIRS (9)
-    unsigned int t_corsairs_tripoli;
-    unsigned int t_corsairs_gibraltar;
-    unsigned int t_allies[TRIP_ALLIES]; /* Corsair count at each location */
-    unsigned int t_infantry[TRIP_INFANTRY_LOCS];
-    unsigned int t_turn_frigates[END_YEAR - START_YEAR];
-    bool tripoli_attacks;
-
-    /* US Player */
 #define MAX_GUNBOATS 3
-    unsigned int us_gunboats;
-    bool swedish_frigates_active;
-    unsigned int patrol_frigates[PATROL_ZONES];
-    unsigned int arab_infantry[US_INFANTRY_LOCS];
-    unsigned int marine_infantry[US_INFANTRY_LOCS];
-    unsigned int us_frigates[NUM_LOCATIONS];
-    unsigned int turn_track_frigates[END_YEAR - START_YEAR];
-
 #define US_CORE_CARD_COUNT (3)
 #define US_DECK_SIZE (24)
 #define MAX_HAND_SIZE (8)
-    struct card **us_core_cards;
-    struct card **us_deck;
-    unsigned int us_deck_size;
-    struct card *us_hand[US_DECK_SIZE]; /* A little overkill but its fine */
-    unsigned int hand_size;
-    struct card *us_discard[US_DECK_SIZE];
-    unsigned int discard_size;
+#define TBOT_DECK_SIZE (18)
+#define TBOT_EVENT_MAX (8)
+#define TBOT_BATTLE_CARD_COUNT (6)
+
+/* Cards are referred to by their index in us_cards[] and tbot_cards[], see
+ * cards.h and tbot.c, and every pile of them is a bitmask of those ids. Only
+ * the event line keeps its order */
+#define CARD_NONE (0xff)
+
+struct game_state {
+    /* Everything the rules read and write comes first. It is all small
+     * integers with no pointers so copying a game is one memcpy() of the
+     * first GAME_HOT_SIZE bytes */
+    struct rng rng;
+    uint16_t year;
+    uint8_t season; /* enum seasons */
+    uint8_t result; /* enum game_result */
+    uint8_t phase; /* enum game_phase */
+
+    /* Tripolitan player */
+    /* Wincons */
+    uint8_t destroyed_us_frigates;
+    uint8_t pirated_gold;
+    uint8_t t_frigates;
+    uint8_t t_damaged_frigates;
+    uint8_t t_corsairs_tripoli;
+    uint8_t t_corsairs_gibraltar;
+    uint8_t t_allies[TRIP_ALLIES]; /* Corsair count at each location */
+    uint8_t t_infantry[TRIP_INFANTRY_LOCS];
+    uint8_t t_turn_frigates[END_YEAR - START_YEAR];
+    bool tripoli_attacks;
+
+    /* US Player */
+    uint8_t us_gunboats;
+    bool swedish_frigates_active;
+    uint8_t patrol_frigates[PATROL_ZONES];
+    uint8_t arab_infantry[US_INFANTRY_LOCS];
+    uint8_t marine_infantry[US_INFANTRY_LOCS];
+    uint8_t us_frigates[NUM_LOCATIONS];
+    uint8_t turn_track_frigates[END_YEAR - START_YEAR];
+    /* Frigates the card being played can still move. Only search stops
+     * partway through a card's moves, see apply_action() */
+    uint8_t us_moves_left;
 
     /* Battle info */
-    unsigned int used_gunboats;
-    unsigned int assigned_gunboats;
-    enum locations gunboat_loc; /* Current gunboat assigned location */
+    uint8_t used_gunboats;
+    uint8_t assigned_gunboats;
+    int8_t gunboat_loc; /* Current gunboat assigned location */
     bool victory_or_death;
     /* Track assault on tripoli damaged frigates */
-    unsigned int us_damaged_frigates;
+    uint8_t us_damaged_frigates;
+
+    /* T-Bot event line in play order, CARD_NONE for an empty slot */
+    uint8_t tbot_event_line[TBOT_EVENT_MAX];
+    /* T-Bot draw pile and unused battle cards */
+    uint32_t tbot_deck;
+    uint32_t tbot_battle_cards;
+
+    /* US core cards, removed from the game once played */
+    uint32_t us_core;
+    uint32_t us_deck;
+    uint32_t us_hand;
+    uint32_t us_discard;
+
+    /* enum battle_type at each location, BATTLE_BITS apiece. Worked out again
+     * by game_write() whenever something it depends on changes, see
+     * location_battle() */
+    uint32_t battles;
+
+    /* Zobrist hash of everything above except the RNG, see game_set() */
+    uint64_t hash;
+
+    /* Ids of the cards in hand and the core cards that can be played, only
+     * good while playable_valid is set. game_write() clears it whenever the
+     * position changes, see playable_cards() */
+    uint32_t playable;
+    bool playable_valid;
+
+    /* Nothing below here is game state, it's about who's playing and who's
+     * watching */
+    uint64_t seed;
+    /* Skip all rendering, set when nobody is watching the terminal */
+    bool headless;
+    /* Makes every US decision, see player.h */
+    const struct player *player;
+    /* Why the last US decision was rejected, NULL if it was accepted */
+    const char *error;
+    /* NULL to skip logging the T-Bot turn */
+    struct tbot_log *log;
+};
 
-    struct {
-#define TBOT_LOG_LEN (2048)
-        char tbot_log[TBOT_LOG_LEN];
-        char *log_ptr;
-    };
+#define GAME_HOT_SIZE (offsetof(struct game_state, hash))
+/* The RNG only decides what comes next, it isn't part of the position */
+#define GAME_HASH_START (offsetof(struct game_state, year))
+
+_Static_assert(GAME_HOT_SIZE <= 128,
+               "hot game state should fit in two cache lines");
+
+#define BATTLE_BITS (2)
+#define BATTLE_MASK ((1u << BATTLE_BITS) - 1)
+
+_Static_assert(NUM_LOCATIONS * BATTLE_BITS <= 32,
+               "every location's battle should fit in game->battles");
+
+/* Locations whose battle depends on each byte of the state, see game.c */
+extern const uint16_t battle_fields[GAME_HOT_SIZE];
+
+void update_battles(struct game_state *game, uint16_t locations);
+
+/* The key for a byte of the state holding a value. Keys come from mixing the
+ * two rather than a table, the same keys as a table filled from splitmix64
+ * but with nothing to set up or keep in cache */
+static inline uint64_t zobrist_key(size_t offset, unsigned int value)
+{
+    uint64_t x = (uint64_t)offset << 8 | value;
+
+    return splitmix64(&x);
+}
+
+/* Writes size bytes of the hashed state and updates the hash for the ones
+ * that changed */
+static inline void game_write(struct game_state *game, void *field,
+                              const void *value, size_t size)
+{
+    unsigned char *dst = field;
+    const unsigned char *src = value;
+    size_t offset = dst - (unsigned char *)game;
+    uint16_t locations = 0;
+    size_t i;
+
+    assert(offset >= GAME_HASH_START && offset + size <= GAME_HOT_SIZE);
+
+    for (i = 0; i < size; i++) {
+        if (dst[i] != src[i]) {
+            game->hash ^= zobrist_key(offset + i, dst[i]) ^
+                zobrist_key(offset + i, src[i]);
+            dst[i] = src[i];
+            locations |= battle_fields[offset + i];
+            game->playable_valid = false;
+        }
+    }
+
+    if (locations != 0) {
+        update_battles(game, locations);
+    }
+}
+
+static inline void game_set_bool(struct game_state *game, bool *field,
+                                 bool value)
+{
+    game_write(game, field, &value, sizeof(value));
+}
+
+static inline void game_set_i8(struct game_state *game, int8_t *field,
+                               int value)
+{
+    int8_t v = value;
+
+    game_write(game, field, &v, sizeof(v));
+}
+
+static inline void game_set_u8(struct game_state *game, uint8_t *field,
+                               int value)
+{
+    uint8_t v = value;
+
+    game_write(game, field, &v, sizeof(v));
+}
+
+static inline void game_set_u16(struct game_state *game, uint16_t *field,
+                                int value)
+{
+    uint16_t v = value;
+
+    game_write(game, field, &v, sizeof(v));
+}
+
+static inline void game_set_u32(struct game_state *game, uint32_t *field,
+                                uint32_t value)
+{
+    game_write(game, field, &value, sizeof(value));
+}
+
+/* Every change to the rules state after init_game_state() goes through these
+ * so game->hash never has to be recomputed */
+#define game_set(game, field, value) \
+    _Generic((field), \
+             bool: game_set_bool, \
+             int8_t: game_set_i8, \
+             uint8_t: game_set_u8, \
+             uint16_t: game_set_u16, \
+             uint32_t: game_set_u32)((game), &(field), (value))
+#define game_add(game, field, delta) game_set(game, field, (field) + (delta))
+#define game_sub(game, field, delta) game_set(game, field, (field) - (delta))
+
+static inline int mask_count(uint32_t mask)
+{
+    return __builtin_popcount(mask);
+}
+
+/* Id of the nth card in a pile, piles are ordered by id */
+static inline int mask_nth(uint32_t mask, int n)
+{
+    assert(n >= 0 && n < mask_count(mask));
+
+    while (n--) {
+        mask &= mask - 1;
+    }
+    return __builtin_ctz(mask);
+}
+
+static inline int hand_size(struct game_state *game)
+{
+    return mask_count(game->us_hand);
+}
+
+static inline int discard_size(struct game_state *game)
+{
+    return mask_count(game->us_discard);
+}
+
+static inline int deck_size(struct game_state *game)
+{
+    return mask_count(game->us_deck);
+}
+
+/* A saved copy of everything the rules can change, including the RNG so play
+ * from a restored snapshot goes the same way every time */
+struct game_snapshot {
+    unsigned char state[GAME_HOT_SIZE];
+    uint64_t hash;
 };
 
+static inline void game_save(const struct game_state *game,
+                             struct game_snapshot *snapshot)
+{
+    memcpy(snapshot->state, game, GAME_HOT_SIZE);
+    snapshot->hash = game->hash;
+}
+
+static inline void game_restore(struct game_state *game,
+                                const struct game_snapshot *snapshot)
+{
+    memcpy(game, snapshot->state, GAME_HOT_SIZE);
+    game->hash = snapshot->hash;
+    game->playable_valid = false;
+}
+
+/* An independent game to play ahead in. It never renders and never writes to
+ * the original's T-Bot log, swap in another player to drive it */
+static inline void game_clone(struct game_state *dst,
+                              const struct game_state *src)
+{
+    memcpy(dst, src, sizeof(*dst));
+    dst->headless = true;
+    dst->log = NULL;
+    dst->error = NULL;
+}
+
 #define MAX_FRIGATE_MOVES (8)
 
 enum zone {
@@ -183,22 +437,53 @@ static inline bool is_date_on_or_past(struct game_state *game, unsigned int year
     return (game->year == year && game->season >= season) || (game->year > year);
 }
 
-static inline unsigned int rolld6()
+static inline bool game_strtou64(const char *str, uint64_t *num)
+{
+    char *endptr;
+    unsigned long long res;
+
+    errno = 0;
+    res = strtoull(str, &endptr, 10);
+    if (endptr == str || *endptr != 0 || errno != 0 || *str == '-') {
+        return false;
+    }
+
+    *num = res;
+    return true;
+}
+
+static inline unsigned int rolld6(struct game_state *game)
 {
-    return rand() % 6 + 1;
+    return rng_range(&game->rng, 6) + 1;
 }
 
-static inline unsigned int rolld6s(int count, int success)
+static inline unsigned int ipow(unsigned int base, int exp)
 {
-    int successes = 0;
+    unsigned int result = 1;
 
-    while (count--) {
-        if (rolld6() >= success) {
-            successes++;
-        }
+    while (exp--) {
+        result *= base;
     }
 
-    return successes;
+    return result;
+}
+
+/* Highest of several d6 from one draw. Every die rolls under k as often as a
+ * draw out of 6^dice lands under k^dice, so the best roll is the first k the
+ * draw is under */
+static inline unsigned int rolld6_best(struct game_state *game, int dice)
+{
+    unsigned int draw;
+    unsigned int roll;
+
+    /* 6^12 is the most that fits a single draw */
+    assert(dice > 0 && dice <= 12);
+
+    draw = rng_range(&game->rng, ipow(6, dice));
+    for (roll = 1; roll < 6 && draw >= ipow(roll, dice); roll++) {
+    }
+
+    return roll;
 }
 
 static inline const char *season_str(enum seasons season)
@@ -327,6 +612,19 @@ static inline bool has_us_infantry(enum locations location)
     return location >= US_INFANTRY_START && location <= US_INFANTRY_END;
 }
 
+static inline enum battle_type location_battle(struct game_state *game,
+                                               enum locations location)
+{
+    assert(location >= 0 && location < NUM_LOCATIONS);
+
+    return (game->battles >> location * BATTLE_BITS) & BATTLE_MASK;
+}
+
+static inline bool battles_pending(struct game_state *game)
+{
+    return game->battles != 0;
+}
+
 static inline bool hamets_army_at(struct game_state *game,
                                   enum locations location)
 {
@@ -340,8 +638,8 @@ static inline bool tripoli_corsair_location(enum locations location)
     return location == TRIPOLI || location == GIBRALTAR;
 }
 
-static inline unsigned int *tripoli_corsair_ptr(struct game_state *game,
-                                                enum locations location)
+static inline uint8_t *tripoli_corsair_ptr(struct game_state *game,
+                                           enum locations location)
 {
     assert(tripoli_corsair_location(location));
 
@@ -351,9 +649,9 @@ static inline unsigned int *tripoli_corsair_ptr(struct game_state *game,
     return &game->t_corsairs_gibraltar;
 }
 
-static inline unsigned int *us_frigate_ptr(struct game_state *game,
-                                           enum locations location,
-                                           enum zone zone)
+static inline uint8_t *us_frigate_ptr(struct game_state *game,
+                                      enum locations location,
+                                      enum zone zone)
 {
     assert(location < NUM_LOCATIONS && location >= 0);
     assert(zone == HARBOR || zone == PATROL_ZONE);
@@ -365,6 +663,30 @@ static inline unsigned int *us_frigate_ptr(struct game_state *game,
     return &game->patrol_frigates[location];
 }
 
+/* Every place a US frigate can be, the harbors followed by the patrol
+ * zones */
+#define FRIGATE_SLOTS (NUM_LOCATIONS + PATROL_ZONES)
+
+static inline int frigate_slot(enum locations location, enum zone zone)
+{
+    return (zone == HARBOR) ? location : NUM_LOCATIONS + location;
+}
+
+static inline enum locations slot_location(int slot)
+{
+    return slot % NUM_LOCATIONS;
+}
+
+static inline enum zone slot_zone(int slot)
+{
+    return (slot < NUM_LOCATIONS) ? HARBOR : PATROL_ZONE;
+}
+
+static inline uint8_t *slot_frigates(struct game_state *game, int slot)
+{
+    return us_frigate_ptr(game, slot_location(slot), slot_zone(slot));
+}
+
 static inline unsigned int max(unsigned int a, unsigned int b)
 {
     return (a > b) ? a : b;
@@ -375,13 +697,17 @@ static inline unsigned int min(unsigned int a, unsigned int b)
     return (a < b) ? a : b;
 }
 
-void init_game_state(struct game_state *game, unsigned int seed);
-void game_loop(struct game_state *game);
+void init_game_state(struct game_state *game, uint64_t seed);
+uint64_t game_compute_hash(const struct game_state *game);
+unsigned int rolld6s(struct game_state *game, int count, int success);
+enum game_result game_step(struct game_state *game);
+enum game_result game_loop(struct game_state *game);
+enum game_result game_over(struct game_state *game, enum game_result result);
 bool build_gunboat(struct game_state *game);
+const char *game_take_action(struct game_state *game, enum us_action action,
+                             int idx);
 const char *game_move_ships(struct game_state *game, int allowed_moves);
 bool game_handle_intercept(struct game_state *game, enum locations location);
-enum battle_type location_battle(struct game_state *game,
-                                 enum locations location);
 const char *validate_moves(struct game_state *game, struct frigate_move *moves,
                            int num_moves, int allowed_moves);
 void move_frigates(struct game_state *game, struct frigate_move *moves,
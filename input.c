@@ -1,8 +1,22 @@
 #include <errno.h>
+#include <inttypes.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "action.h"
+#include "assault.h"
 #include "cards.h"
 #include "input.h"
+#include "mcts.h"
+#include "odds.h"
+#include "player.h"
+#include "tbot.h"
+
+/* Default advise search, whichever limit is hit first */
+#define ADVISE_PLAYOUTS (100000)
+#define ADVISE_SECONDS (10.0)
+#define ADVISE_TOP (5)
+#define ADVISE_TABLE_MB (64)
 
 static const char *play_command(struct game_state *game, bool core)
 {
@@ -17,11 +31,8 @@ static const char *play_command(struct game_state *game, bool core)
         return "Invalid card index";
     }
 
-    if (core) {
-        return play_core_card(game, card_idx);
-    }
-
-    return play_card_from_hand(game, card_idx);
+    return game_take_action(game, core ? US_PLAY_CORE : US_PLAY_CARD,
+                            card_idx);
 }
 
 static const char *discard_command(struct game_state *game)
@@ -29,14 +40,13 @@ static const char *discard_command(struct game_state *game)
     char *idx_str = strtok(NULL, sep);
     char *action;
     int card_idx;
-    const char *ret;
 
     if (idx_str == NULL) {
         return "Missing card number";
     }
 
     if (!game_strtol(idx_str, &card_idx) || card_idx < 0 ||
-        card_idx >= game->hand_size) {
+        card_idx >= hand_size(game)) {
         return "Invalid card index";
     }
 
@@ -47,21 +57,363 @@ static const char *discard_command(struct game_state *game)
 
     if (strcmp(action, "build") == 0 || strcmp(action, "b") == 0 ||
         strcmp(action, "gunboat") == 0 || strcmp(action, "g") == 0) {
-        if (!build_gunboat(game)) {
-            return "Cannot build any more gunboats";
-        }
+        return game_take_action(game, US_BUILD_GUNBOAT, card_idx);
     } else if (strcmp(action, "move") == 0 || strcmp(action, "m") == 0) {
-        ret = game_move_ships(game, 2);
-        if (ret) {
-            return ret;
+        return game_take_action(game, US_MOVE_FRIGATES, card_idx);
+    }
+
+    return "Invalid discard command";
+}
+
+/* Searches the current turn and lists the best actions it found */
+static const char *advise_command(struct game_state *game)
+{
+    static char advice[2048];
+    /* Allocated on first use and kept for the rest of the game */
+    static struct tt *table;
+    char *playouts_str = strtok(NULL, sep);
+    struct mcts_config config = {
+        .iterations = ADVISE_PLAYOUTS,
+        .seconds = ADVISE_SECONDS,
+        .threads = sysconf(_SC_NPROCESSORS_ONLN),
+        /* The player can't see the coming draws so neither should advice */
+        .determinize = true,
+    };
+    struct mcts_stat stats[ADVISE_TOP];
+    struct tt_counters counters;
+    unsigned long playouts;
+    char action[256];
+    int num_stats;
+    int iterations;
+    int len;
+    int i;
+
+    if (playouts_str != NULL) {
+        if (!game_strtol(playouts_str, &iterations) || iterations <= 0) {
+            return "Invalid number of playouts";
+        }
+        config.iterations = iterations;
+    }
+
+    if (table == NULL) {
+        table = tt_new(ADVISE_TABLE_MB);
+    }
+    if (table != NULL) {
+        tt_clear(table);
+    }
+    config.tt = table;
+
+    num_stats = mcts_search(game, &config, stats, ADVISE_TOP, &playouts);
+    len = snprintf(advice, sizeof(advice), "Best actions after %lu playouts:",
+                   playouts);
+    for (i = 0; i < num_stats && len < sizeof(advice); i++) {
+        action_str(game, stats[i].action, action, sizeof(action));
+        len += snprintf(advice + len, sizeof(advice) - len,
+                        "\n%s : %lu visits, %.1f%% wins, value %.3f", action,
+                        stats[i].visits, stats[i].win_rate * 100,
+                        stats[i].value);
+    }
+
+    if (table != NULL && len < sizeof(advice)) {
+        tt_get_counters(table, &counters);
+        snprintf(advice + len, sizeof(advice) - len,
+                 "\nTable: %lu hits, %lu misses, %lu collisions",
+                 counters.hits, counters.misses, counters.collisions);
+    }
+
+    return advice;
+}
+
+/* Appends a line of outcomes with their chances, leaving out the ones too
+ * unlikely to show */
+static size_t append_dist(char *buf, size_t size, size_t len,
+                          const char *label, const struct odds_dist *dist)
+{
+    int i;
+
+    if (len < size) {
+        len += snprintf(buf + len, size - len, "\n  %s:", label);
+    }
+    for (i = 0; i <= dist->max && len < size; i++) {
+        if (dist->p[i] >= 0.0005) {
+            len += snprintf(buf + len, size - len, " %d %.1f%%", i,
+                            dist->p[i] * 100);
+        }
+    }
+    if (len < size) {
+        len += snprintf(buf + len, size - len, " (avg %.2f)",
+                        odds_mean(dist));
+    }
+
+    return len;
+}
+
+static const char *held_str(struct game_state *game, struct card *card)
+{
+    return (card_in_hand(game, card) >= 0) ? "in hand" : "not in hand";
+}
+
+static size_t append_naval_odds(struct game_state *game,
+                                enum locations location, char *buf,
+                                size_t size, size_t len)
+{
+    struct odds_options options = {
+        .guns_of_tripoli = location == TRIPOLI &&
+            tbot_guns_of_tripoli_ready(game),
+    };
+    struct odds_battle battle;
+    struct odds_dist sunk;
+    int gunboats = game->us_gunboats - game->used_gunboats;
+    int frigates = game->us_frigates[location] + game->us_damaged_frigates;
+    int variant;
+
+    if (len < size) {
+        len += snprintf(buf + len, size - len, "Naval battle at %s%s",
+                        location_str(location), (options.guns_of_tripoli) ?
+                        ", the T-Bot will play The Guns of Tripoli" : "");
+    }
+
+    /* Bit 0 plays Preble's Boys, bit 1 brings in the gunboats */
+    for (variant = 0; variant < 4; variant++) {
+        if ((variant & 2) && gunboats == 0) {
+            continue;
+        }
+        options.prebles_boys = variant & 1;
+        options.gunboats = (variant & 2) ? gunboats : 0;
+
+        if (len < size) {
+            len += snprintf(buf + len, size - len, "\n%s", (variant) ? "With" :
+                            "Frigates only");
+        }
+        if ((variant & 1) && len < size) {
+            len += snprintf(buf + len, size - len, " Preble's Boys (%s)%s",
+                            held_str(game, &prebles_boys),
+                            (variant & 2) ? " and" : "");
+        }
+        if ((variant & 2) && len < size) {
+            len += snprintf(buf + len, size - len, " %d gunboats from Malta",
+                            gunboats);
+        }
+
+        odds_naval_battle(game, location, &options, &battle);
+        odds_corsairs_sunk(game, location, &battle.us_hits, &sunk);
+        odds_cap(&battle.t_hits, frigates * 2 + options.gunboats);
+        len = append_dist(buf, size, len, (has_trip_allies(location)) ?
+                          "Allies sunk" : "Corsairs sunk", &sunk);
+        len = append_dist(buf, size, len, "Hits taken", &battle.t_hits);
+    }
+
+    return len;
+}
+
+static size_t append_bombardment_odds(struct game_state *game,
+                                      enum locations location, char *buf,
+                                      size_t size, size_t len)
+{
+    struct odds_options options = { 0 };
+    struct odds_dist killed;
+    int gunboats = game->us_gunboats - game->used_gunboats;
+
+    if (len < size) {
+        len += snprintf(buf + len, size - len, "Naval bombardment at %s\n"
+                        "Frigates only", location_str(location));
+    }
+    odds_naval_bombardment(game, location, &options, &killed);
+    len = append_dist(buf, size, len, "Infantry killed", &killed);
+
+    if (gunboats > 0) {
+        if (len < size) {
+            len += snprintf(buf + len, size - len,
+                            "\nWith %d gunboats from Malta", gunboats);
+        }
+        options.gunboats = gunboats;
+        odds_naval_bombardment(game, location, &options, &killed);
+        len = append_dist(buf, size, len, "Infantry killed", &killed);
+    }
+
+    return len;
+}
+
+static size_t append_ground_odds(struct game_state *game,
+                                 enum locations location, char *buf,
+                                 size_t size, size_t len)
+{
+    struct odds_options options = { 0 };
+    struct odds_battle battle;
+    int idx = us_infantry_idx(location);
+    int variant;
+
+    if (len < size) {
+        len += snprintf(buf + len, size - len,
+                        "Ground combat at %s, first round",
+                        location_str(location));
+    }
+
+    /* Bit 0 plays Lieutenant Leads the Charge, bit 1 Marine Sharpshooters */
+    for (variant = 0; variant < 4; variant++) {
+        options.lieutenant = variant & 1;
+        options.sharpshooters = variant & 2;
+
+        if (len < size) {
+            len += snprintf(buf + len, size - len, "\n%s", (variant) ? "With" :
+                            "No cards");
+        }
+        if ((variant & 1) && len < size) {
+            len += snprintf(buf + len, size - len,
+                            " Lieutenant Leads the Charge (%s)%s",
+                            held_str(game, &lieutenant_leads_the_charge),
+                            (variant & 2) ? " and" : "");
+        }
+        if ((variant & 2) && len < size) {
+            len += snprintf(buf + len, size - len,
+                            " Marine Sharpshooters (%s)",
+                            held_str(game, &marine_sharpshooters));
+        }
+
+        odds_ground_combat(game, location, &options, &battle);
+        odds_cap(&battle.us_hits,
+                 game->t_infantry[trip_infantry_idx(location)]);
+        odds_cap(&battle.t_hits,
+                 game->marine_infantry[idx] + game->arab_infantry[idx]);
+        len = append_dist(buf, size, len, "Infantry killed", &battle.us_hits);
+        len = append_dist(buf, size, len, "Infantry lost", &battle.t_hits);
+    }
+
+    return len;
+}
+
+/* What the frigates on patrol would sink if the T-Bot raided from here */
+static size_t append_intercept_odds(struct game_state *game,
+                                    enum locations location, char *buf,
+                                    size_t size, size_t len)
+{
+    struct odds_options options = { 0 };
+    struct odds_dist sunk;
+
+    if (len < size) {
+        len += snprintf(buf + len, size - len,
+                        "%sInterception off %s if the T-Bot raids\n"
+                        "Frigates only", (len) ? "\n" : "",
+                        location_str(location));
+    }
+    odds_intercept(game, location, &options, &sunk);
+    len = append_dist(buf, size, len, "Corsairs sunk", &sunk);
+
+    if (game->patrol_frigates[location] > 0) {
+        if (len < size) {
+            len += snprintf(buf + len, size - len,
+                            "\nWith Lieutenant in Pursuit (%s)",
+                            held_str(game, &lieutenant_in_pursuit));
         }
+        options.lieutenant = true;
+        odds_intercept(game, location, &options, &sunk);
+        len = append_dist(buf, size, len, "Corsairs sunk", &sunk);
+    }
+
+    return len;
+}
+
+/* Exact odds for the battle at a location as things stand, with and without
+ * the cards and gunboats that could join it */
+static const char *odds_command(struct game_state *game)
+{
+    static char odds[4096];
+    char *loc_str = strtok(NULL, sep);
+    enum locations location;
+    bool patrolled;
+    int raiders;
+    size_t len = 0;
+
+    if (loc_str == NULL) {
+        return "Missing location";
+    }
+
+    location = parse_location(loc_str);
+    if (location == INVALID_LOCATION) {
+        return "Invalid location";
+    }
+
+    switch (location_battle(game, location)) {
+        case NAVAL_BATTLE:
+            len = append_naval_odds(game, location, odds, sizeof(odds), len);
+            break;
+        case NAVAL_BOMBARDMENT:
+            len = append_bombardment_odds(game, location, odds, sizeof(odds),
+                                          len);
+            break;
+        case GROUND_BATTLE:
+            len = append_ground_odds(game, location, odds, sizeof(odds), len);
+            break;
+        default:
+            break;
+    }
+
+    if (has_patrol_zone(location) && location != GIBRALTAR) {
+        raiders = (location == TRIPOLI) ? game->t_corsairs_tripoli :
+            game->t_allies[location];
+        patrolled = game->patrol_frigates[location] > 0 ||
+            (location == TRIPOLI && game->swedish_frigates_active);
+        if (raiders > 0 && patrolled) {
+            len = append_intercept_odds(game, location, odds, sizeof(odds),
+                                        len);
+        }
+    }
+
+    if (len == 0) {
+        return "No battle is occurring at this location";
+    }
+
+    return odds;
+}
+
+/* Whether to go for it, the exact chance of winning the Assault on Tripoli if
+ * it started now */
+static const char *assault_command(struct game_state *game)
+{
+    static char assault[512];
+    struct assault_state state;
+    double chance;
+    int len;
+
+    assault_state_from_game(game, &state);
+    if (!assault_win_chance(&state, &chance)) {
+        return "Too many units on the board to work out the assault";
+    }
+
+    if (game->victory_or_death) {
+        len = snprintf(assault, sizeof(assault),
+                       "The assault is under way");
     } else {
-        return "Invalid discard command";
+        len = snprintf(assault, sizeof(assault),
+                       "Assault on Tripoli now (%s, %s)",
+                       (card_in_hand(game, &assault_on_tripoli) >= 0) ?
+                       "in hand" : "not in hand",
+                       assault_on_tripoli.playable(game) ? "playable" :
+                       "not playable yet");
+    }
+    if (len < sizeof(assault)) {
+        snprintf(assault + len, sizeof(assault) - len,
+                 ": %.1f%% to win\n%d frigates, %d damaged and %d gunboats "
+                 "against %d frigates, %d damaged and %d corsairs\n"
+                 "%d marines and %d Arab infantry against %d infantry",
+                 chance * 100, state.frigates, state.damaged_frigates,
+                 state.gunboats, state.t_frigates, state.t_damaged_frigates,
+                 state.t_corsairs, state.marines, state.arabs,
+                 state.t_infantry);
     }
 
-    discard_from_hand(game, card_idx);
+    return assault;
+}
 
-    return NULL;
+/* Debugging aid, the hash kept up to date as the game changes next to one
+ * worked out from scratch. They should always match */
+static const char *hash_command(struct game_state *game)
+{
+    static char hash[64];
+
+    snprintf(hash, sizeof(hash), "Hash %016" PRIx64 " (recomputed %016" PRIx64
+             ")", game->hash, game_compute_hash(game));
+    return hash;
 }
 
 static const char *help_command()
@@ -72,6 +424,13 @@ static const char *help_command()
         "[discard/d] [card number] [move/m,gunboat/g] : "
         "discard a card to move 2 frigates or build a gunboat. ex: d 2 g, "
         "discard 3 move\n"
+        "[advise/a] [playouts] : search for the best actions this turn. ex: "
+        "advise, a 50000\n"
+        "[odds/o] [location] : show the odds of the battle at a location. "
+        "ex: odds tripoli, o tunis\n"
+        "[assault] : show the chance of winning the Assault on Tripoli "
+        "right now\n"
+        "[hash] : print the game state hash\n"
         "[help/h/?] : print this useful message\n"
         "[quit/q] : quit the game";
 }
@@ -90,6 +449,14 @@ static const char *parse_command(struct game_state *game, char *line)
         return play_command(game, true);
     } else if (strcmp(command, "discard") == 0 || strcmp(command, "d") == 0) {
         return discard_command(game);
+    } else if (strcmp(command, "advise") == 0 || strcmp(command, "a") == 0) {
+        return advise_command(game);
+    } else if (strcmp(command, "odds") == 0 || strcmp(command, "o") == 0) {
+        return odds_command(game);
+    } else if (strcmp(command, "assault") == 0) {
+        return assault_command(game);
+    } else if (strcmp(command, "hash") == 0) {
+        return hash_command(game);
     } else if (strcmp(command, "help") == 0 || strcmp(command, "h") == 0 ||
                strcmp(command, "?") == 0) {
         return help_command();
@@ -103,7 +470,7 @@ static const char *parse_command(struct game_state *game, char *line)
     }
 }
 
-const char *handle_input(struct game_state *game)
+static const char *terminal_take_turn(struct game_state *game)
 {
     char *line = NULL;
     const char *ret;
@@ -117,8 +484,111 @@ const char *handle_input(struct game_state *game)
     return ret;
 }
 
-const char *parse_moves(struct frigate_move *moves, int *num_moves,
-                        int allowed_moves)
+static const char *terminal_discard_down(struct game_state *game, int *idx)
+{
+    char *line;
+
+    cprintf(BOLD ITALIC RED, "Too many cards in hand choose a card to "
+            "discard\n");
+    prompt();
+
+    line = input_getline();
+    if (!game_strtol(line, idx)) {
+        free(line);
+        return "Invalid card number";
+    }
+
+    free(line);
+    return NULL;
+}
+
+static const char *terminal_choose_battle(struct game_state *game,
+                                          enum locations *location)
+{
+    char *line;
+
+    cprintf(BOLD WHITE, "Enter a location to resolve a battle at: ");
+    line = input_getline();
+    *location = parse_location(line);
+
+    free(line);
+    return NULL;
+}
+
+static bool terminal_play_battle_card(struct game_state *game,
+                                      struct card *card)
+{
+    char msg[128];
+
+    snprintf(msg, sizeof(msg), "Play [ %s ] as a battle card?", card->name);
+    return yn_prompt(msg);
+}
+
+static const char *terminal_assign_gunboats(struct game_state *game,
+                                            enum locations location,
+                                            enum zone zone, int *gunboats)
+{
+    char *line;
+
+    cprintf(BOLD WHITE, "Choose how many gunboats to bring to the battle at "
+            "%s %s\n", location_str(location), zone_str(zone));
+    prompt();
+    line = input_getline();
+
+    if (!game_strtol(line, gunboats)) {
+        free(line);
+        return "Invalid number provided";
+    }
+
+    free(line);
+    return NULL;
+}
+
+static const char *terminal_assign_damage(struct game_state *game,
+                                          enum locations location,
+                                          enum zone zone, int num_hits,
+                                          enum battle_type btype,
+                                          struct damage_assignment *damage)
+{
+    char *line;
+    int len;
+    int i;
+    const char *btype_str = (btype == NAVAL_BATTLE) ? "naval" : "ground";
+
+    cprintf(BOLD WHITE, "Assign %d hits for %s battle at %s %s:"
+            "(F to destroy a frigate, f to damage a frigate or destroy a damaged"
+            "frigate, G/g to destroy a gunboat, A/a for arab infantry, "
+            "M/m for US marines)\n", num_hits, btype_str,
+            location_str(location), zone_str(zone));
+    prompt();
+    line = input_getline();
+
+    len = strlen(line);
+    for (i = 0; i < len; i++) {
+        if (line[i] == 'g' || line[i] == 'G') {
+            damage->destroy_gunboats++;
+        } else if (line[i] == 'f') {
+            damage->damage_frigates++;
+        } else if (line[i] == 'F') {
+            damage->destroy_frigates++;
+        } else if (line[i] == 'M' || line[i] == 'm') {
+            damage->destroy_marines++;
+        } else if (line[i] == 'A' || line[i] == 'a') {
+            damage->destroy_arabs++;
+        } else if (line[i] != ' ') {
+            free(line);
+            return "Invalid character found for assigning damage";
+        }
+    }
+
+    free(line);
+    return NULL;
+}
+
+static const char *terminal_move_frigates(struct game_state *game,
+                                          int allowed_moves,
+                                          struct frigate_move *moves,
+                                          int *num_moves)
 {
     int move_idx = 0;
     bool first = true;
@@ -177,7 +647,7 @@ const char *parse_moves(struct frigate_move *moves, int *num_moves,
             return "Missing move quantity";
         }
 
-        if (!game_strtol(count_str, &count) || count == 0) {
+        if (!game_strtol(count_str, &count) || count <= 0) {
             free(line);
             return "Invalid move value or count";
         }
@@ -195,101 +665,239 @@ const char *parse_moves(struct frigate_move *moves, int *num_moves,
     return NULL;
 }
 
-const char *parse_damage_assignment(struct game_state *game,
-                                    enum locations location,
-                                    enum zone zone, int num_hits,
-                                    enum battle_type btype)
+static const char *terminal_deploy_frigate(struct game_state *game,
+                                           enum locations *location)
 {
     char *line;
-    int destroy_frigates = 0;
-    int damage_frigates = 0;
-    int destroy_gunboats = 0;
-    int destroy_marines = 0;
-    int destroy_arabs = 0;
-    int len;
-    int i;
-    const char *err;
-    const char *btype_str = (btype == NAVAL_BATTLE) ? "naval" : "ground";
 
-    assert(btype == NAVAL_BATTLE || btype == GROUND_BATTLE);
+    cprintf(BOLD WHITE, "Choose a patrol zone to deploy to\n");
+    prompt();
 
-    if (num_hits == 0) {
-        return NULL;
-    }
+    line = input_getline();
+    *location = parse_location(line);
 
-    if (try_auto_assign_damage(game, location, zone, num_hits, btype)) {
-        return NULL;
+    free(line);
+    return NULL;
+}
+
+/* Reads [location] [patrol/harbor] [quantity] triples until the line runs out,
+ * the destination is filled in by the engine. str is passed to the first
+ * strtok so NULL carries on from an earlier token */
+static const char *parse_source_moves(char *str, struct frigate_move *moves,
+                                      int *num_moves, int max_moves)
+{
+    char *from_str;
+    char *zone_str;
+    char *quantity_str;
+    int quantity;
+    struct frigate_move *move;
+
+    *num_moves = 0;
+    for (from_str = strtok(str, sep); from_str != NULL;
+         from_str = strtok(NULL, sep)) {
+        if (*num_moves == max_moves) {
+            return "Too many moves specified";
+        }
+
+        zone_str = strtok(NULL, sep);
+        if (zone_str == NULL) {
+            return "Missing location zone, patrol or harbor";
+        }
+
+        quantity_str = strtok(NULL, sep);
+        if (quantity_str == NULL) {
+            return "No quantity of frigates to move provided";
+        }
+
+        move = &moves[(*num_moves)++];
+        move->from = parse_location(from_str);
+        if (move->from == INVALID_LOCATION) {
+            return "Invalid location for move provided";
+        }
+
+        move->from_zone = parse_zone(zone_str);
+        if (move->from_zone == INVALID_ZONE) {
+            return "Invalid location zone provided";
+        }
+
+        if (!game_strtol(quantity_str, &quantity) || quantity <= 0) {
+            return "Invalid move quantity provided";
+        }
+        move->quantity = quantity;
     }
 
-    cprintf(BOLD WHITE, "Assign %d hits for %s battle at %s %s:"
-            "(F to destroy a frigate, f to damage a frigate or destroy a damaged"
-            "frigate, G/g to destroy a gunboat, A/a for arab infantry, "
-            "M/m for US marines)\n", num_hits, btype_str,
-            location_str(location), zone_str(zone));
+    return NULL;
+}
+
+static const char *terminal_show_of_force(struct game_state *game,
+                                          enum locations *ally,
+                                          struct frigate_move *moves,
+                                          int *num_moves)
+{
+    char *line;
+    char *ally_str;
+    const char *err;
+
+    cprintf(BOLD WHITE, "Choose which Tripoli ally to return to supply and "
+            "what frigates to move: [algiers/tangier/tunis] [location] "
+            "[patrol/harbor] [quantity]...\n");
     prompt();
     line = input_getline();
 
-    len = strlen(line);
-    for (i = 0; i < len; i++) {
-        if (line[i] == 'g' || line[i] == 'G') {
-            destroy_gunboats++;
-        } else if (line[i] == 'f') {
-            damage_frigates++;
-        } else if (line[i] == 'F') {
-            destroy_frigates++;
-        } else if (line[i] == 'M' || line[i] == 'm') {
-            destroy_marines++;
-        } else if (line[i] == 'A' || line[i] == 'a') {
-            destroy_arabs++;
-        } else if (line[i] != ' ') {
-            free(line);
-            return "Invalid character found for assigning damage";
-        }
+    ally_str = strtok(line, sep);
+    if (ally_str == NULL) {
+        free(line);
+        return "No Tripolitan ally selected";
     }
+    *ally = parse_location(ally_str);
 
-    if (btype == NAVAL_BATTLE) {
-        err = assign_naval_damage(game, location, zone, num_hits,
-                                  destroy_frigates, damage_frigates,
-                                  destroy_gunboats);
-    } else {
-        err = assign_ground_damage(game, location, num_hits, destroy_marines,
-                                   destroy_arabs);
-    }
+    err = parse_source_moves(NULL, moves, num_moves, 3);
 
     free(line);
     return err;
 }
 
-const char *parse_assign_gunboats(struct game_state *game,
-                                  enum locations location,
-                                  enum zone zone)
+static const char *terminal_tribute_paid(struct game_state *game,
+                                         enum locations *ally,
+                                         struct frigate_move *move)
 {
     char *line;
-    int gunboats;
+    char *from_str;
+    char *zone_str;
+    char *to_str;
 
-    /* No boats to assign */
-    if (game->used_gunboats == game->us_gunboats) {
-        return NULL;
+    cprintf(BOLD, "Choose location to move frigate from and location to move "
+            "to. [location] [harbor/patrol] [algiers/tunis/tangier]\n");
+    prompt();
+    line = input_getline();
+
+    from_str = strtok(line, sep);
+    if (from_str == NULL) {
+        free(line);
+        return "No location to move frigate from provided";
     }
 
-    cprintf(BOLD WHITE, "Choose how many gunboats to bring to the battle at "
-            "%s %s\n", location_str(location), zone_str(zone));
+    zone_str = strtok(NULL, sep);
+    if (zone_str == NULL) {
+        free(line);
+        return "No harbor or patrol zone specified";
+    }
+
+    to_str = strtok(NULL, sep);
+    if (to_str == NULL) {
+        free(line);
+        return "Destination harbor not specified";
+    }
+
+    move->from = parse_location(from_str);
+    move->from_zone = parse_zone(zone_str);
+    *ally = parse_location(to_str);
+
+    free(line);
+    return NULL;
+}
+
+static const char *terminal_hamet_move_frigates(struct game_state *game,
+                                                enum locations dest,
+                                                struct frigate_move *moves,
+                                                int *num_moves)
+{
+    char *line;
+    const char *err;
+
+    cprintf(BOLD WHITE, "Move up to three frigates to the %s harbor: "
+            "[location] [patrol/harbor] [quantity]...\n", location_str(dest));
+    prompt();
+
+    line = input_getline();
+    err = parse_source_moves(line, moves, num_moves, 3);
+
+    free(line);
+    return err;
+}
+
+static const char *terminal_choose_from_discard(struct game_state *game,
+                                                bool *play, int *idx)
+{
+    char *line;
+    char *action;
+    char *idx_str;
+
+    print_discard_pile(game);
+    cprintf(BOLD WHITE, "Choose which card to take or play "
+            "(ex : \"take 3\", \"play 2\", \"t 0\", \"p 3\"):\n");
     prompt();
+
     line = input_getline();
 
-    if (!game_strtol(line, &gunboats)) {
+    action = strtok(line, sep);
+    if (action == NULL) {
         free(line);
-        return "Invalid number provided";
+        return "Invalid action for [ Brainbridge Supplies Intel ]";
+    }
+
+    idx_str = strtok(NULL, sep);
+    if (idx_str == NULL) {
+        free(line);
+        return "No card selected";
     }
 
-    if (gunboats > (game->us_gunboats - game->used_gunboats)) {
+    if (!game_strtol(idx_str, idx)) {
         free(line);
-        return "Too many gunboats chosen";
+        return "Invalid card number";
     }
 
-    game->assigned_gunboats = gunboats;
-    game->used_gunboats += gunboats;
+    if (strcmp(action, "play") == 0 || strcmp(action, "p") == 0) {
+        *play = true;
+    } else if (strcmp(action, "take") == 0 || strcmp(action, "t") == 0) {
+        *play = false;
+    } else {
+        free(line);
+        return "Invalid action, must take or play a card";
+    }
+
+    free(line);
+    return NULL;
+}
+
+static const char *terminal_sink_corsairs(struct game_state *game, int count,
+                                          enum locations *locations,
+                                          int *num_locations)
+{
+    char *line;
+    char *loc_str;
+
+    cprintf(BOLD WHITE, "Choose locations to sink up to %d corsairs from\n",
+            count);
+    prompt();
+    line = input_getline();
+
+    *num_locations = 0;
+    for (loc_str = strtok(line, sep); loc_str != NULL;
+         loc_str = strtok(NULL, sep)) {
+        if (*num_locations == count) {
+            free(line);
+            return "Too many locations provided";
+        }
+        locations[(*num_locations)++] = parse_location(loc_str);
+    }
 
     free(line);
     return NULL;
 }
+
+const struct player terminal_player = {
+    .take_turn = terminal_take_turn,
+    .discard_down = terminal_discard_down,
+    .choose_battle = terminal_choose_battle,
+    .play_battle_card = terminal_play_battle_card,
+    .assign_gunboats = terminal_assign_gunboats,
+    .assign_damage = terminal_assign_damage,
+    .move_frigates = terminal_move_frigates,
+    .deploy_frigate = terminal_deploy_frigate,
+    .show_of_force = terminal_show_of_force,
+    .tribute_paid = terminal_tribute_paid,
+    .hamet_move_frigates = terminal_hamet_move_frigates,
+    .choose_from_discard = terminal_choose_from_discard,
+    .sink_corsairs = terminal_sink_corsairs,
+};
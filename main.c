@@ -8,11 +8,18 @@
 #include <stdlib.h>
 #include <unistd.h>
 
+#include "assault.h"
+#include "display.h"
 #include "game.h"
+#include "sim.h"
 
 static struct option longopts[] =
 {
     {"seed", required_argument, NULL, 's'},
+    {"simulate", required_argument, NULL, 'S'},
+    {"check-sessions", required_argument, NULL, 'C'},
+    {"threads", required_argument, NULL, 't'},
+    {"tablebase", required_argument, NULL, 'T'},
     {"help", no_argument, NULL, 'h'},
     {NULL, 0, NULL, 0}
 };
@@ -21,6 +28,15 @@ static void usage()
 {
     const char *usage_str =
         "-s --seed : Set the game seed. Default: time based seed\n"
+        "-S --simulate [games] : Play games headless with a random US player "
+        "and report the results. Game seeds start from --seed\n"
+        "-C --check-sessions [games] : Play games with the random US player "
+        "both directly and through suspendable sessions and report any that "
+        "end differently\n"
+        "-t --threads [count] : Threads to simulate with. Default: one per "
+        "CPU\n"
+        "-T --tablebase [file] : Solve every start of the Assault on Tripoli "
+        "and write the tablebase to file\n"
         "-h --help : Print this usage text\n";
 
     printf("%s", usage_str);
@@ -41,7 +57,13 @@ static void crash_handler(int signal)
 int main(int argc, char **argv)
 {
     struct game_state game;
-    int seed = 0;
+    static struct tbot_log log;
+    uint64_t seed = 0;
+    int simulate = 0;
+    int check_sessions = 0;
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *tablebase = NULL;
+    const char *err;
     int ch;
 
 #if !defined(__CYGWIN__) && !defined(__MINGW32__)
@@ -49,14 +71,36 @@ int main(int argc, char **argv)
     signal(SIGABRT, crash_handler);
 #endif /* !defined(__CYGWIN__) && !defined(__MINGW32__) */
 
-    while ((ch = getopt_long(argc, argv, "hs:", longopts, NULL)) != -1) {
+    while ((ch = getopt_long(argc, argv, "hs:S:C:t:T:", longopts, NULL)) != -1) {
         switch (ch) {
             case 's':
-                if (!game_strtol(optarg, &seed)) {
+                if (!game_strtou64(optarg, &seed)) {
                     fprintf(stderr, "Invalid seed value\n");
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case 'S':
+                if (!game_strtol(optarg, &simulate) || simulate <= 0) {
+                    fprintf(stderr, "Invalid number of games to simulate\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'C':
+                if (!game_strtol(optarg, &check_sessions) ||
+                    check_sessions <= 0) {
+                    fprintf(stderr, "Invalid number of games to check\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 't':
+                if (!game_strtol(optarg, &threads) || threads <= 0) {
+                    fprintf(stderr, "Invalid number of threads\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'T':
+                tablebase = optarg;
+                break;
             case 'h':
                 usage();
                 exit(EXIT_SUCCESS);
@@ -66,9 +110,41 @@ int main(int argc, char **argv)
         }
     }
 
+    if (tablebase != NULL) {
+        err = assault_write_tablebase(tablebase, threads);
+        if (err != NULL) {
+            fprintf(stderr, "%s\n", err);
+            exit(EXIT_FAILURE);
+        }
+        return 0;
+    }
+
+    /* Optional, the assault is solved on demand without it */
+    if (access(ASSAULT_TABLEBASE_FILE, F_OK) == 0) {
+        err = assault_load_tablebase(ASSAULT_TABLEBASE_FILE);
+        if (err != NULL) {
+            fprintf(stderr, "%s, run make tablebase\n", err);
+        }
+    }
+
+    if (simulate) {
+        sim_run(simulate, seed, threads);
+        return 0;
+    }
+
+    if (check_sessions) {
+        return (sim_check_sessions(check_sessions, seed) == 0) ?
+            EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     init_game_state(&game, seed);
+    game.log = &log;
 
     game_loop(&game);
 
+    /* Re-render the window to show how the game ended */
+    display_game(&game);
+    print_game_result(&game);
+
     return 0;
 }
@@ -0,0 +1,794 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "action.h"
+#include "assault.h"
+#include "cards.h"
+#include "mcts.h"
+#include "player.h"
+#include "tt.h"
+
+/* Playout scores are kept in fixed point so every statistic is an integer
+ * atomic */
+#define MCTS_SCALE (1 << 16)
+/* Almost every playout is a loss scoring well under a quarter, a smaller
+ * constant than the textbook sqrt(2) keeps the search from only exploring */
+#define MCTS_EXPLORE (0.5)
+/* One US turn per season is the deepest a line can go. Naval Movement takes
+ * its moves in two actions and Thomas Jefferson, once a game, in four, see
+ * action.h */
+#define MCTS_MAX_DEPTH (((END_YEAR - START_YEAR + 1) * 4 + 1) * 2 + 2)
+#define MCTS_CHUNK_NODES (4096)
+/* Playouts between looks at the clock */
+#define MCTS_CLOCK_CHECK (32)
+/* Most playouts a new node takes from the transposition table */
+#define MCTS_TT_PRIOR (32)
+
+/* The US takes turns against an environment of dice, draws and the T-Bot.
+ *
+ * By default every playout starts from a copy of the same state, RNG
+ * included, so the state under a node is always the same and the tree is an
+ * ordinary game tree. Children are claimed in legal_actions() order one per
+ * visit until all have been tried.
+ *
+ * That search knows every future draw and roll though. With
+ * config->determinize each playout reseeds its copy instead. Draws pick from
+ * the us_deck and tbot_deck masks, which only hold cards that haven't been
+ * seen, so this deals a fresh order consistent with the discard pile and the
+ * T-Bot log. All the deals share one tree. A node then stands for whatever
+ * states its actions led to, so children are matched by key rather than hand
+ * position, and UCB counts how often a child was available rather than how
+ * often its parent was visited */
+struct mcts_node {
+    struct mcts_node *_Atomic children;
+    struct mcts_node *sibling;
+    /* The action as first played and the same action by card id, see
+     * action_key() */
+    uint32_t action;
+    uint32_t key;
+    /* Legal actions from here, listed on the first visit. The US turn can
+     * have thousands so they aren't worth listing again. Not used when
+     * determinizing, they change with every deal */
+    struct mcts_actions *_Atomic actions;
+    /* Legal actions claimed for expansion, may overshoot */
+    atomic_uint expanded;
+    /* Held while a determinized visit adds a child */
+    atomic_flag expanding;
+    /* Visits to the parent where this was a legal action */
+    atomic_ulong available;
+    /* Bumped on the way down so a playout still in flight counts as a loss
+     * until its score lands, which is the virtual loss that spreads the
+     * threads over different lines */
+    atomic_ulong visits;
+    /* Half points, 2 for a win and 1 for a draw */
+    atomic_ulong wins;
+    atomic_ulong score;
+    /* Visits taken from the transposition table when the node was made
+     * rather than played out through it */
+    unsigned long prior;
+};
+
+/* Nodes come from chunks owned by one worker so threads never contend on
+ * allocation */
+struct mcts_chunk {
+    struct mcts_chunk *next;
+    int used;
+    struct mcts_node nodes[MCTS_CHUNK_NODES];
+};
+
+/* Owned by the worker that listed them first */
+struct mcts_actions {
+    struct mcts_actions *next;
+    unsigned int count;
+    uint32_t actions[];
+};
+
+/* Maps the action keys of the current determinized visit to their index in
+ * the worker's action list. Entries from older visits are told apart by
+ * stamp so the table is never cleared */
+struct key_slot {
+    uint32_t key;
+    uint32_t stamp;
+    int idx;
+    bool has_child;
+};
+
+struct mcts_tree {
+    struct game_state *game;
+    const struct mcts_config *config;
+    /* Determinized playouts are dealt from seed + playout number */
+    uint64_t seed;
+    struct mcts_node root;
+    atomic_ulong started;
+    atomic_bool stop;
+    struct timespec start;
+};
+
+struct mcts_worker {
+    pthread_t thread;
+    struct mcts_tree *tree;
+    struct mcts_chunk *chunks;
+    struct mcts_actions *action_lists;
+    uint32_t *actions;
+    int max_actions;
+    struct tt_counters tt_counters;
+    struct key_slot *slots;
+    unsigned int slot_mask;
+    int slot_bits;
+    uint32_t stamp;
+};
+
+static void init_node(struct mcts_node *node, uint32_t action, uint32_t key)
+{
+    atomic_init(&node->children, NULL);
+    node->sibling = NULL;
+    node->action = action;
+    node->key = key;
+    atomic_init(&node->actions, NULL);
+    atomic_init(&node->expanded, 0);
+    atomic_flag_clear(&node->expanding);
+    atomic_init(&node->available, 0);
+    atomic_init(&node->visits, 0);
+    atomic_init(&node->wins, 0);
+    atomic_init(&node->score, 0);
+    node->prior = 0;
+}
+
+static struct mcts_node *new_node(struct mcts_worker *worker, uint32_t action,
+                                  uint32_t key)
+{
+    struct mcts_chunk *chunk = worker->chunks;
+    struct mcts_node *node;
+
+    if (chunk == NULL || chunk->used == MCTS_CHUNK_NODES) {
+        chunk = malloc(sizeof(*chunk));
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = worker->chunks;
+        chunk->used = 0;
+        worker->chunks = chunk;
+    }
+
+    node = &chunk->nodes[chunk->used++];
+    init_node(node, action, key);
+
+    return node;
+}
+
+static void free_worker(struct mcts_worker *worker)
+{
+    struct mcts_chunk *chunk;
+    struct mcts_actions *list;
+
+    while ((chunk = worker->chunks) != NULL) {
+        worker->chunks = chunk->next;
+        free(chunk);
+    }
+    while ((list = worker->action_lists) != NULL) {
+        worker->action_lists = list->next;
+        free(list);
+    }
+    free(worker->actions);
+    free(worker->slots);
+}
+
+/* Every legal action into the worker's buffer, growing it as needed. Returns
+ * -1 if it can't grow */
+static int list_actions(struct mcts_worker *worker, struct game_state *game)
+{
+    int num_actions = legal_actions(game, worker->actions, worker->max_actions);
+    uint32_t *actions;
+
+    if (num_actions > worker->max_actions) {
+        actions = realloc(worker->actions, num_actions * sizeof(*actions));
+        if (actions == NULL) {
+            return -1;
+        }
+        worker->actions = actions;
+        worker->max_actions = num_actions;
+        legal_actions(game, worker->actions, worker->max_actions);
+    }
+
+    return num_actions;
+}
+
+/* Lists the legal actions of the game under node unless another visit
+ * already has. NULL if there's no memory for them */
+static struct mcts_actions *node_actions(struct mcts_worker *worker,
+                                         struct mcts_node *node,
+                                         struct game_state *game)
+{
+    struct mcts_actions *list = atomic_load(&node->actions);
+    struct mcts_actions *expected = NULL;
+    int num_actions;
+
+    if (list != NULL) {
+        return list;
+    }
+
+    num_actions = list_actions(worker, game);
+    if (num_actions < 0) {
+        return NULL;
+    }
+
+    list = malloc(sizeof(*list) + num_actions * sizeof(*list->actions));
+    if (list == NULL) {
+        return NULL;
+    }
+    list->count = num_actions;
+    memcpy(list->actions, worker->actions,
+           num_actions * sizeof(*list->actions));
+
+    /* Every thread lists the same actions, the first one in wins */
+    if (!atomic_compare_exchange_strong(&node->actions, &expected, list)) {
+        free(list);
+        return expected;
+    }
+    list->next = worker->action_lists;
+    worker->action_lists = list;
+
+    return list;
+}
+
+/* Runs the game until the US has a turn to take or it's over */
+static void advance(struct game_state *game)
+{
+    while (game->result == GAME_IN_PROGRESS &&
+           (game->phase != PHASE_US_TURN || hand_size(game) > MAX_HAND_SIZE)) {
+        game_step(game);
+    }
+}
+
+static void play_action(struct game_state *game, uint32_t action)
+{
+    /* A decision inside a played card can still be refused, the rollout
+     * player takes the turn instead */
+    if (apply_action(game, action) != NULL) {
+        while (game->result == GAME_IN_PROGRESS &&
+               game->phase == PHASE_US_TURN) {
+            game_step(game);
+        }
+    }
+
+    advance(game);
+}
+
+/* The random rollout player almost never wins, so scoring only wins would
+ * give the search nothing to go on. Losses score up to a quarter by how many
+ * seasons the US held out */
+static unsigned long loss_score(struct game_state *game)
+{
+    int seasons = (game->year - START_YEAR) * 4 + game->season;
+
+    return (unsigned long)MCTS_SCALE / 4 * seasons /
+        ((END_YEAR - START_YEAR + 1) * 4);
+}
+
+static unsigned long playout_score(struct game_state *game)
+{
+    switch (game->result) {
+        case US_TREATY_WIN:
+        case US_ASSAULT_WIN:
+            return MCTS_SCALE;
+        case GAME_DRAW:
+            return MCTS_SCALE / 2;
+        default:
+            return loss_score(game);
+    }
+}
+
+static unsigned long playout_wins(struct game_state *game)
+{
+    switch (game->result) {
+        case US_TREATY_WIN:
+        case US_ASSAULT_WIN:
+            return 2;
+        case GAME_DRAW:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Plays the rollout out. An Assault on Tripoli the tablebase holds scores
+ * its exact win chance rather than one random assault, and counts as a win as
+ * often as it would be one */
+static void finish_playout(struct game_state *game, unsigned long *score,
+                           unsigned long *wins)
+{
+    struct assault_state assault;
+    double chance;
+
+    while (game->result == GAME_IN_PROGRESS) {
+        if (game->victory_or_death && game->phase == PHASE_BATTLES) {
+            assault_state_from_game(game, &assault);
+            if (assault_tablebase_chance(&assault, &chance)) {
+                *score = lround(chance * MCTS_SCALE +
+                                (1 - chance) * loss_score(game));
+                *wins = (rng_range(&game->rng, MCTS_SCALE) <
+                         chance * MCTS_SCALE) ? 2 : 0;
+                return;
+            }
+        }
+        game_step(game);
+    }
+
+    *score = playout_score(game);
+    *wins = playout_wins(game);
+}
+
+/* UCB1 over the children linked so far, NULL if none are yet */
+static struct mcts_node *select_child(struct mcts_node *node)
+{
+    struct mcts_node *child;
+    struct mcts_node *best = NULL;
+    double log_visits = log(atomic_load(&node->visits));
+    double best_ucb = -1.0;
+    double ucb;
+    unsigned long visits;
+
+    for (child = atomic_load(&node->children); child != NULL;
+         child = child->sibling) {
+        /* Never 0, a child is visited before it is linked */
+        visits = atomic_load(&child->visits);
+        ucb = (double)atomic_load(&child->score) / MCTS_SCALE / visits +
+            MCTS_EXPLORE * sqrt(log_visits / visits);
+        if (ucb > best_ucb) {
+            best_ucb = ucb;
+            best = child;
+        }
+    }
+
+    return best;
+}
+
+/* Hand positions shift as cards come and go, a card keeps its id across
+ * every deal */
+static uint32_t action_key(struct game_state *game, uint32_t action)
+{
+    uint32_t moves = action & ~(uint32_t)0xff;
+
+    /* The moves partway through a card don't name one */
+    if (game->us_moves_left > 0) {
+        return action;
+    }
+
+    switch (action_type(action)) {
+        case US_PLAY_CARD:
+        case US_BUILD_GUNBOAT:
+        case US_MOVE_FRIGATES:
+            return moves | action_make(action_type(action),
+                                       mask_nth(game->us_hand,
+                                                action_idx(action)));
+        case US_PLAY_CORE:
+            return moves | action_make(US_PLAY_CORE,
+                                       mask_nth(game->us_core,
+                                                action_idx(action)));
+        default:
+            return action;
+    }
+}
+
+/* Empty slot for the key if it isn't in the table */
+static struct key_slot *find_key(struct mcts_worker *worker, uint32_t key)
+{
+    /* The low bits only tell the card apart, the top of the product mixes in
+     * the moves */
+    unsigned int i = (key * 0x9e3779b1u) >> (32 - worker->slot_bits);
+
+    while (worker->slots[i].stamp == worker->stamp &&
+           worker->slots[i].key != key) {
+        i = (i + 1) & worker->slot_mask;
+    }
+
+    return &worker->slots[i];
+}
+
+/* Fills the key table from the worker's action list */
+static bool build_key_set(struct mcts_worker *worker, struct game_state *game,
+                          int num_actions)
+{
+    unsigned int size = 64;
+    int bits = 6;
+    struct key_slot *slot;
+    uint32_t key;
+    int i;
+
+    while (size < 2 * num_actions) {
+        size *= 2;
+        bits++;
+    }
+
+    if (worker->slots == NULL || size > worker->slot_mask + 1) {
+        free(worker->slots);
+        worker->slots = calloc(size, sizeof(*worker->slots));
+        if (worker->slots == NULL) {
+            return false;
+        }
+        worker->slot_mask = size - 1;
+        worker->slot_bits = bits;
+        worker->stamp = 0;
+    }
+
+    if (++worker->stamp == 0) {
+        memset(worker->slots, 0,
+               (worker->slot_mask + 1) * sizeof(*worker->slots));
+        worker->stamp = 1;
+    }
+
+    for (i = 0; i < num_actions; i++) {
+        key = action_key(game, worker->actions[i]);
+        slot = find_key(worker, key);
+        slot->key = key;
+        slot->stamp = worker->stamp;
+        slot->idx = i;
+        slot->has_child = false;
+    }
+
+    return true;
+}
+
+static void link_child(struct mcts_node *node, struct mcts_node *child)
+{
+    struct mcts_node *head = atomic_load(&node->children);
+
+    do {
+        child->sibling = head;
+    } while (!atomic_compare_exchange_weak(&node->children, &head, child));
+}
+
+/* Picks the child to follow from node. Sets expanded if it's a new leaf and
+ * action to the action that gets there in this game. NULL if there's nowhere
+ * to go */
+static struct mcts_node *descend(struct mcts_worker *worker,
+                                 struct mcts_node *node,
+                                 struct game_state *game, uint32_t *action,
+                                 bool *expanded)
+{
+    struct mcts_actions *actions = node_actions(worker, node, game);
+    struct mcts_node *child;
+    unsigned int claimed;
+
+    if (actions == NULL) {
+        atomic_store(&worker->tree->stop, true);
+        return NULL;
+    }
+
+    if (atomic_load(&node->expanded) < actions->count &&
+        (claimed = atomic_fetch_add(&node->expanded, 1)) < actions->count) {
+        child = new_node(worker, actions->actions[claimed],
+                         actions->actions[claimed]);
+        if (child == NULL) {
+            atomic_store(&worker->tree->stop, true);
+            return NULL;
+        }
+        atomic_store(&child->visits, 1);
+        link_child(node, child);
+        *expanded = true;
+        *action = child->action;
+        return child;
+    }
+
+    child = select_child(node);
+    if (child != NULL) {
+        atomic_fetch_add(&child->visits, 1);
+        *expanded = false;
+        *action = child->action;
+    }
+
+    return child;
+}
+
+/* Adds a child for the action at idx unless another thread got there first */
+static struct mcts_node *expand_determinized(struct mcts_worker *worker,
+                                             struct mcts_node *node,
+                                             struct game_state *game, int idx)
+{
+    uint32_t key = action_key(game, worker->actions[idx]);
+    struct mcts_node *child;
+
+    for (child = atomic_load(&node->children); child != NULL;
+         child = child->sibling) {
+        if (child->key == key) {
+            return NULL;
+        }
+    }
+
+    child = new_node(worker, worker->actions[idx], key);
+    if (child == NULL) {
+        atomic_store(&worker->tree->stop, true);
+        return NULL;
+    }
+    atomic_store(&child->visits, 1);
+    atomic_store(&child->available, 1);
+    link_child(node, child);
+
+    return child;
+}
+
+/* descend() for a determinized game. Only children legal in this deal are
+ * candidates, each counts as available, and the first legal action without a
+ * child yet gets one */
+static struct mcts_node *descend_determinized(struct mcts_worker *worker,
+                                              struct mcts_node *node,
+                                              struct game_state *game,
+                                              uint32_t *action,
+                                              bool *expanded)
+{
+    int num_actions = list_actions(worker, game);
+    struct mcts_node *child;
+    struct mcts_node *best = NULL;
+    struct key_slot *slot;
+    double best_ucb = -1.0;
+    double ucb;
+    unsigned long visits;
+    unsigned long available;
+    int best_idx = 0;
+    int i;
+
+    if (num_actions < 0 || !build_key_set(worker, game, num_actions)) {
+        atomic_store(&worker->tree->stop, true);
+        return NULL;
+    }
+
+    for (child = atomic_load(&node->children); child != NULL;
+         child = child->sibling) {
+        slot = find_key(worker, child->key);
+        if (slot->stamp != worker->stamp) {
+            continue;
+        }
+        slot->has_child = true;
+
+        available = atomic_fetch_add(&child->available, 1) + 1;
+        visits = atomic_load(&child->visits);
+        ucb = (double)atomic_load(&child->score) / MCTS_SCALE / visits +
+            MCTS_EXPLORE * sqrt(log(available) / visits);
+        if (ucb > best_ucb) {
+            best_ucb = ucb;
+            best = child;
+            best_idx = slot->idx;
+        }
+    }
+
+    for (i = 0; i < num_actions; i++) {
+        if (find_key(worker, action_key(game, worker->actions[i]))->has_child) {
+            continue;
+        }
+
+        /* Whoever holds the lock is adding a child already, follow an
+         * existing one instead */
+        if (atomic_flag_test_and_set(&node->expanding)) {
+            break;
+        }
+        child = expand_determinized(worker, node, game, i);
+        atomic_flag_clear(&node->expanding);
+
+        if (child != NULL) {
+            *expanded = true;
+            *action = worker->actions[i];
+            return child;
+        }
+        break;
+    }
+
+    if (best != NULL) {
+        atomic_fetch_add(&best->visits, 1);
+        *expanded = false;
+        *action = worker->actions[best_idx];
+    }
+
+    return best;
+}
+
+/* Positions reached down another line, or in another deal, are already in
+ * the table. A new node for one starts out with what the table knows */
+static void seed_from_table(struct mcts_worker *worker, struct mcts_node *node,
+                            uint64_t hash)
+{
+    struct tt_value value;
+    unsigned long visits;
+
+    if (!tt_probe(worker->tree->config->tt, hash, &value,
+                  &worker->tt_counters)) {
+        return;
+    }
+
+    visits = (value.visits < MCTS_TT_PRIOR) ? value.visits : MCTS_TT_PRIOR;
+    node->prior = visits;
+    atomic_fetch_add(&node->visits, visits);
+    atomic_fetch_add(&node->score, value.score * visits / value.visits *
+                     (MCTS_SCALE / TT_SCORE_SCALE));
+}
+
+/* One selection, expansion, playout and backup */
+static void mcts_iterate(struct mcts_worker *worker, unsigned long playout)
+{
+    struct mcts_tree *tree = worker->tree;
+    struct mcts_node *path[MCTS_MAX_DEPTH + 1];
+    /* Position after each step of the path */
+    uint64_t hashes[MCTS_MAX_DEPTH + 1];
+    struct tt *tt = tree->config->tt;
+    struct mcts_node *node = &tree->root;
+    struct mcts_node *child;
+    struct game_state game;
+    unsigned long score;
+    unsigned long wins;
+    uint32_t action;
+    bool expanded;
+    int depth = 0;
+    int i;
+
+    game_clone(&game, tree->game);
+    game.player = &random_player;
+    if (tree->config->determinize) {
+        rng_seed(&game.rng, tree->seed + playout);
+    }
+
+    atomic_fetch_add(&node->visits, 1);
+    path[depth++] = node;
+
+    while (game.result == GAME_IN_PROGRESS && depth <= MCTS_MAX_DEPTH) {
+        /* Only the RNG differs between deals at the root so its actions
+         * never change */
+        if (tree->config->determinize && node != &tree->root) {
+            child = descend_determinized(worker, node, &game, &action,
+                                         &expanded);
+        } else {
+            child = descend(worker, node, &game, &action, &expanded);
+        }
+        if (child == NULL) {
+            break;
+        }
+
+        path[depth] = child;
+        play_action(&game, action);
+        hashes[depth++] = game.hash;
+        if (expanded) {
+            if (tt != NULL) {
+                seed_from_table(worker, child, game.hash);
+            }
+            break;
+        }
+        node = child;
+    }
+
+    finish_playout(&game, &score, &wins);
+    for (i = 0; i < depth; i++) {
+        atomic_fetch_add(&path[i]->score, score);
+        atomic_fetch_add(&path[i]->wins, wins);
+    }
+
+    /* The root's position is the same for every playout */
+    for (i = 1; tt != NULL && i < depth; i++) {
+        tt_add(tt, hashes[i], i, 1, score / (MCTS_SCALE / TT_SCORE_SCALE),
+               &worker->tt_counters);
+    }
+}
+
+static double elapsed_seconds(const struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) +
+        (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void *mcts_worker_run(void *arg)
+{
+    struct mcts_worker *worker = arg;
+    struct mcts_tree *tree = worker->tree;
+    const struct mcts_config *config = tree->config;
+    unsigned long n;
+
+    while (!atomic_load(&tree->stop)) {
+        n = atomic_fetch_add(&tree->started, 1);
+        if (config->iterations && n >= config->iterations) {
+            break;
+        }
+        if (config->seconds > 0 && n % MCTS_CLOCK_CHECK == 0 &&
+            elapsed_seconds(&tree->start) >= config->seconds) {
+            atomic_store(&tree->stop, true);
+            break;
+        }
+
+        mcts_iterate(worker, n);
+    }
+
+    return NULL;
+}
+
+/* Keeps stats sorted by visits, dropping whatever falls off the end */
+static void insert_stat(struct mcts_stat *stats, int *num_stats,
+                        int max_stats, const struct mcts_stat *stat)
+{
+    int i = min(*num_stats, max_stats - 1);
+
+    if (*num_stats == max_stats && stats[i].visits >= stat->visits) {
+        return;
+    }
+
+    for (; i > 0 && stats[i - 1].visits < stat->visits; i--) {
+        stats[i] = stats[i - 1];
+    }
+    stats[i] = *stat;
+    *num_stats = min(*num_stats + 1, max_stats);
+}
+
+/* Searches the US turn the game is waiting on with config->threads threads
+ * sharing one tree. Fills stats with the most visited actions first and
+ * returns how many were filled in */
+int mcts_search(struct game_state *game, const struct mcts_config *config,
+                struct mcts_stat *stats, int max_stats,
+                unsigned long *playouts)
+{
+    struct mcts_tree tree;
+    struct mcts_worker *workers;
+    struct mcts_node *child;
+    struct mcts_stat stat;
+    struct rng rng;
+    int num_workers = max(config->threads, 1);
+    int num_stats = 0;
+    int i;
+
+    assert(game->phase == PHASE_US_TURN);
+
+    tree.game = game;
+    tree.config = config;
+    rng = game->rng;
+    tree.seed = rng_next(&rng);
+    init_node(&tree.root, 0, 0);
+    atomic_init(&tree.started, 0);
+    atomic_init(&tree.stop, false);
+    clock_gettime(CLOCK_MONOTONIC, &tree.start);
+
+    workers = calloc(num_workers, sizeof(*workers));
+    if (workers == NULL) {
+        *playouts = 0;
+        return 0;
+    }
+
+    for (i = 0; i < num_workers; i++) {
+        workers[i].tree = &tree;
+    }
+
+    /* The calling thread works too, if a thread can't start the rest of the
+     * search just runs on fewer */
+    for (i = 1; i < num_workers; i++) {
+        if (pthread_create(&workers[i].thread, NULL, mcts_worker_run,
+                           &workers[i]) != 0) {
+            num_workers = i;
+            break;
+        }
+    }
+    mcts_worker_run(&workers[0]);
+    for (i = 1; i < num_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    for (child = atomic_load(&tree.root.children); child != NULL;
+         child = child->sibling) {
+        stat.action = child->action;
+        stat.visits = atomic_load(&child->visits) - child->prior;
+        stat.win_rate = atomic_load(&child->wins) / 2.0 / stat.visits;
+        stat.value = (double)atomic_load(&child->score) / MCTS_SCALE /
+            atomic_load(&child->visits);
+        insert_stat(stats, &num_stats, max_stats, &stat);
+    }
+    *playouts = atomic_load(&tree.root.visits);
+
+    for (i = 0; i < max(config->threads, 1); i++) {
+        if (config->tt != NULL) {
+            tt_add_counters(config->tt, &workers[i].tt_counters);
+        }
+        free_worker(&workers[i]);
+    }
+    free(workers);
+
+    return num_stats;
+}
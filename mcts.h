@@ -0,0 +1,36 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+#include "tt.h"
+
+struct mcts_config {
+    /* The search stops at whichever limit comes first, 0 means no limit */
+    unsigned long iterations;
+    double seconds;
+    int threads;
+    /* Deal every playout a fresh order for the unseen cards and rolls, see
+     * mcts.c */
+    bool determinize;
+    /* Shared by every thread, NULL to search without one */
+    struct tt *tt;
+};
+
+/* How one US action at the root fared */
+struct mcts_stat {
+    uint32_t action;
+    unsigned long visits;
+    /* US wins with draws counted as half */
+    double win_rate;
+    /* Average playout score the search maximised, see playout_score() */
+    double value;
+};
+
+int mcts_search(struct game_state *game, const struct mcts_config *config,
+                struct mcts_stat *stats, int max_stats,
+                unsigned long *playouts);
+
+#endif /* MCTS_H */
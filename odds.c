@@ -0,0 +1,301 @@
+#include <math.h>
+#include <pthread.h>
+
+#include "odds.h"
+
+/* Every roll in the game hits on a 6, or on a 5 or better for raids and
+ * Marine Sharpshooters, so two tables of binomial chances cover them all.
+ * binomial[hit_on_5][dice][hits] */
+static double binomial[2][ODDS_MAX_DICE + 1][ODDS_MAX_DICE + 1];
+/* The same chances summed up to each number of hits and scaled to a 64 bit
+ * draw, cdf[hit_on_5][dice][hits] */
+static uint64_t cdf[2][ODDS_MAX_DICE + 1][ODDS_MAX_DICE + 1];
+static pthread_once_t binomial_once = PTHREAD_ONCE_INIT;
+
+/* Pascal's rule one row at a time, exact up to rounding in the last bit */
+static void init_binomial(void)
+{
+    double p, sum;
+    int table, dice, hits;
+
+    for (table = 0; table < 2; table++) {
+        p = (table) ? 2.0 / 6 : 1.0 / 6;
+        binomial[table][0][0] = 1.0;
+        for (dice = 1; dice <= ODDS_MAX_DICE; dice++) {
+            for (hits = 0; hits <= dice; hits++) {
+                binomial[table][dice][hits] =
+                    binomial[table][dice - 1][hits] * (1 - p);
+                if (hits > 0) {
+                    binomial[table][dice][hits] +=
+                        binomial[table][dice - 1][hits - 1] * p;
+                }
+            }
+        }
+
+        for (dice = 0; dice <= ODDS_MAX_DICE; dice++) {
+            sum = 0;
+            for (hits = 0; hits < dice; hits++) {
+                sum += binomial[table][dice][hits];
+                cdf[table][dice][hits] =
+                    (sum < 1) ? (uint64_t)ldexp(sum, 64) : UINT64_MAX;
+            }
+            cdf[table][dice][dice] = UINT64_MAX;
+        }
+    }
+}
+
+/* Hits from rolling dice that each hit on success or better, the same roll as
+ * rolld6s() */
+void odds_roll(int dice, int success, struct odds_dist *dist)
+{
+    int hits;
+
+    assert(dice >= 0 && dice <= ODDS_MAX_DICE);
+    assert(success == 5 || success == 6);
+
+    pthread_once(&binomial_once, init_binomial);
+
+    dist->max = dice;
+    for (hits = 0; hits <= dice; hits++) {
+        dist->p[hits] = binomial[success == 5][dice][hits];
+    }
+}
+
+/* Draws at or above cdf[hits] roll more than that many hits, see rolld6s() */
+const uint64_t *odds_cdf(int dice, int success)
+{
+    assert(dice >= 0 && dice <= ODDS_MAX_DICE);
+    assert(success == 5 || success == 6);
+
+    pthread_once(&binomial_once, init_binomial);
+
+    return cdf[success == 5][dice];
+}
+
+/* Hits from rolling both pools at once */
+void odds_add(const struct odds_dist *a, const struct odds_dist *b,
+              struct odds_dist *sum)
+{
+    struct odds_dist out;
+    int i, j;
+
+    assert(a->max + b->max <= ODDS_MAX_DICE);
+
+    out.max = a->max + b->max;
+    for (i = 0; i <= out.max; i++) {
+        out.p[i] = 0;
+    }
+    for (i = 0; i <= a->max; i++) {
+        for (j = 0; j <= b->max; j++) {
+            out.p[i + j] += a->p[i] * b->p[j];
+        }
+    }
+
+    *sum = out;
+}
+
+/* Hits past what there is to hit don't do anything more */
+void odds_cap(struct odds_dist *dist, int cap)
+{
+    int hits;
+
+    assert(cap >= 0);
+
+    if (cap >= dist->max) {
+        return;
+    }
+
+    for (hits = cap + 1; hits <= dist->max; hits++) {
+        dist->p[cap] += dist->p[hits];
+    }
+    dist->max = cap;
+}
+
+double odds_at_least(const struct odds_dist *dist, int hits)
+{
+    double p = 0;
+    int i;
+
+    for (i = (hits > 0) ? hits : 0; i <= dist->max; i++) {
+        p += dist->p[i];
+    }
+
+    return p;
+}
+
+double odds_mean(const struct odds_dist *dist)
+{
+    double mean = 0;
+    int i;
+
+    for (i = 0; i <= dist->max; i++) {
+        mean += i * dist->p[i];
+    }
+
+    return mean;
+}
+
+/* Corsairs lost to the US hits of a naval battle. The T-Bot takes hits on its
+ * frigates first up until 1805, and on its corsairs first after that. See
+ * apply_damage() in tbot.c */
+void odds_corsairs_sunk(struct game_state *game, enum locations location,
+                        const struct odds_dist *hits, struct odds_dist *sunk)
+{
+    struct odds_dist out;
+    int corsairs;
+    int shield = 0;
+    int i;
+
+    if (has_trip_allies(location)) {
+        *sunk = *hits;
+        odds_cap(sunk, game->t_allies[location]);
+        return;
+    }
+
+    assert(location == TRIPOLI);
+    corsairs = game->t_corsairs_tripoli;
+    if (game->year <= 1804 ||
+        (game->year == 1805 && game->season == WINTER) ||
+        game->victory_or_death) {
+        shield = game->t_frigates;
+    }
+
+    out.max = corsairs;
+    for (i = 0; i <= corsairs; i++) {
+        out.p[i] = 0;
+    }
+    for (i = 0; i <= hits->max; i++) {
+        out.p[(i > shield) ? min(i - shield, corsairs) : 0] += hits->p[i];
+    }
+
+    *sunk = out;
+}
+
+static int raiding_corsairs(struct game_state *game, enum locations location)
+{
+    if (has_trip_allies(location)) {
+        return game->t_allies[location];
+    } else if (location == TRIPOLI) {
+        return game->t_corsairs_tripoli;
+    }
+    return game->t_corsairs_gibraltar;
+}
+
+/* Corsairs sunk by the frigates on patrol, see game_handle_intercept() */
+void odds_intercept(struct game_state *game, enum locations location,
+                    const struct odds_options *options,
+                    struct odds_dist *destroyed)
+{
+    int frigates = game->patrol_frigates[location];
+    int dice = frigates * ((options->lieutenant) ? 3 : FRIGATE_DICE);
+
+    assert(has_patrol_zone(location));
+
+    if (location == TRIPOLI && game->swedish_frigates_active) {
+        dice += 2 * FRIGATE_DICE;
+    }
+
+    odds_roll(dice, 6, destroyed);
+    odds_cap(destroyed, raiding_corsairs(game, location));
+}
+
+/* Gold taken by a raid, what's left to raid after the interception is different
+ * for every interception roll. See pirate_raid() in tbot.c */
+void odds_pirate_raid(struct game_state *game, enum locations location,
+                      const struct odds_options *options,
+                      struct odds_dist *gold)
+{
+    struct odds_dist destroyed;
+    struct odds_dist raid;
+    int corsairs = raiding_corsairs(game, location);
+    int extra = (options->happy_hunting) ? 3 : 0;
+    int lost, hits;
+
+    odds_intercept(game, location, options, &destroyed);
+
+    gold->max = corsairs + extra;
+    for (hits = 0; hits <= gold->max; hits++) {
+        gold->p[hits] = 0;
+    }
+    for (lost = 0; lost <= destroyed.max; lost++) {
+        odds_roll(corsairs - lost + extra, 5, &raid);
+        for (hits = 0; hits <= raid.max; hits++) {
+            gold->p[hits] += destroyed.p[lost] * raid.p[hits];
+        }
+    }
+}
+
+/* See resolve_naval_battle() and tbot_resolve_naval_battle() */
+void odds_naval_battle(struct game_state *game, enum locations location,
+                       const struct odds_options *options,
+                       struct odds_battle *battle)
+{
+    int frigates = game->us_frigates[location] + game->us_damaged_frigates;
+    int us_dice = frigates * ((options->prebles_boys) ? 3 : FRIGATE_DICE) +
+        options->gunboats;
+    int t_dice;
+
+    assert(has_trip_allies(location) || location == TRIPOLI);
+
+    if (has_trip_allies(location)) {
+        t_dice = game->t_allies[location];
+    } else {
+        t_dice = (game->t_frigates + game->t_damaged_frigates) * FRIGATE_DICE +
+            game->t_corsairs_tripoli;
+        if (options->guns_of_tripoli) {
+            t_dice += 12;
+        }
+    }
+
+    odds_roll(us_dice, 6, &battle->us_hits);
+    odds_roll(t_dice, 6, &battle->t_hits);
+}
+
+/* Infantry killed from the harbor, see resolve_naval_bombardment() */
+void odds_naval_bombardment(struct game_state *game, enum locations location,
+                            const struct odds_options *options,
+                            struct odds_dist *destroyed)
+{
+    int frigates = game->us_frigates[location] + game->us_damaged_frigates;
+
+    assert(has_trip_infantry(location));
+
+    odds_roll(frigates * FRIGATE_DICE + options->gunboats, 6, destroyed);
+    odds_cap(destroyed, game->t_infantry[trip_infantry_idx(location)]);
+}
+
+/* A single round, the rounds after it depend on how the US takes its losses.
+ * Mercenaries Desert isn't counted, the T-Bot only holds it for Derne. See
+ * resolve_ground_combat() */
+void odds_ground_combat(struct game_state *game, enum locations location,
+                        const struct odds_options *options,
+                        struct odds_battle *battle)
+{
+    struct odds_dist arabs;
+    int idx = us_infantry_idx(location);
+    int marines = game->marine_infantry[idx];
+
+    assert(has_us_infantry(location) && has_trip_infantry(location));
+
+    if (options->lieutenant && marines > 0) {
+        marines += 2;
+    }
+
+    odds_roll(marines, (options->sharpshooters) ? 5 : 6, &battle->us_hits);
+    odds_roll(game->arab_infantry[idx], 6, &arabs);
+    odds_add(&battle->us_hits, &arabs, &battle->us_hits);
+    odds_roll(game->t_infantry[trip_infantry_idx(location)], 6,
+              &battle->t_hits);
+}
+
+/* The lone frigate on patrol off Tripoli against the Tripoli harbor, see
+ * play_tripoli_attacks() in tbot.c */
+void odds_tripoli_attacks(struct game_state *game,
+                          const struct odds_options *options,
+                          struct odds_battle *battle)
+{
+    odds_roll((options->prebles_boys) ? 3 : FRIGATE_DICE, 6,
+              &battle->us_hits);
+    odds_roll(game->t_corsairs_tripoli + game->t_frigates * FRIGATE_DICE, 6,
+              &battle->t_hits);
+}
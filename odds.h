@@ -0,0 +1,70 @@
+#ifndef ODDS_H
+#define ODDS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "game.h"
+
+/* Largest pool of dice any battle rolls, T-Bot's whole navy with The Guns of
+ * Tripoli comes to well under this */
+#define ODDS_MAX_DICE (64)
+
+/* Chance of each number of hits, p[hits] for hits = 0..max */
+struct odds_dist {
+    int max;
+    double p[ODDS_MAX_DICE + 1];
+};
+
+/* What goes into the battle beyond the game state. Nothing is taken from the
+ * hands, a card counts as played if its flag is set */
+struct odds_options {
+    /* Gunboats assigned to a naval battle or bombardment */
+    int gunboats;
+    bool prebles_boys;
+    /* Lieutenant in Pursuit for interceptions, Lieutenant Leads the Charge
+     * for ground combat */
+    bool lieutenant;
+    bool sharpshooters;
+    bool guns_of_tripoli;
+    bool happy_hunting;
+};
+
+/* Hits each side rolls in one round of a battle, before they're capped by
+ * what there is to hit */
+struct odds_battle {
+    struct odds_dist us_hits;
+    struct odds_dist t_hits;
+};
+
+void odds_roll(int dice, int success, struct odds_dist *dist);
+const uint64_t *odds_cdf(int dice, int success);
+void odds_add(const struct odds_dist *a, const struct odds_dist *b,
+              struct odds_dist *sum);
+void odds_cap(struct odds_dist *dist, int cap);
+double odds_at_least(const struct odds_dist *dist, int hits);
+double odds_mean(const struct odds_dist *dist);
+
+void odds_corsairs_sunk(struct game_state *game, enum locations location,
+                        const struct odds_dist *hits, struct odds_dist *sunk);
+
+void odds_intercept(struct game_state *game, enum locations location,
+                    const struct odds_options *options,
+                    struct odds_dist *destroyed);
+void odds_pirate_raid(struct game_state *game, enum locations location,
+                      const struct odds_options *options,
+                      struct odds_dist *gold);
+void odds_naval_battle(struct game_state *game, enum locations location,
+                       const struct odds_options *options,
+                       struct odds_battle *battle);
+void odds_naval_bombardment(struct game_state *game, enum locations location,
+                            const struct odds_options *options,
+                            struct odds_dist *destroyed);
+void odds_ground_combat(struct game_state *game, enum locations location,
+                        const struct odds_options *options,
+                        struct odds_battle *battle);
+void odds_tripoli_attacks(struct game_state *game,
+                          const struct odds_options *options,
+                          struct odds_battle *battle);
+
+#endif /* ODDS_H */
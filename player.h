@@ -0,0 +1,58 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include "cards.h"
+#include "game.h"
+
+struct damage_assignment {
+    int destroy_frigates;
+    int damage_frigates;
+    int destroy_gunboats;
+    int destroy_marines;
+    int destroy_arabs;
+};
+
+/* Every decision the US player makes. Callbacks only choose, the engine
+ * validates the answer and applies it, and an error string sends the same
+ * question again where the rules allow it */
+struct player {
+    /* Take the action for the turn, same contract as playing a card */
+    const char *(*take_turn)(struct game_state *game);
+    const char *(*discard_down)(struct game_state *game, int *idx);
+    const char *(*choose_battle)(struct game_state *game,
+                                 enum locations *location);
+    bool (*play_battle_card)(struct game_state *game, struct card *card);
+    const char *(*assign_gunboats)(struct game_state *game,
+                                   enum locations location, enum zone zone,
+                                   int *gunboats);
+    const char *(*assign_damage)(struct game_state *game,
+                                 enum locations location, enum zone zone,
+                                 int num_hits, enum battle_type btype,
+                                 struct damage_assignment *damage);
+    /* Free movement for Naval Movement, Thomas Jefferson and discarding */
+    const char *(*move_frigates)(struct game_state *game, int allowed_moves,
+                                 struct frigate_move *moves, int *num_moves);
+    const char *(*deploy_frigate)(struct game_state *game,
+                                  enum locations *location);
+    /* Only the source of each move is chosen, the engine sends them to the
+     * ally or Eaton's destination harbor */
+    const char *(*show_of_force)(struct game_state *game, enum locations *ally,
+                                 struct frigate_move *moves, int *num_moves);
+    const char *(*tribute_paid)(struct game_state *game, enum locations *ally,
+                                struct frigate_move *move);
+    const char *(*hamet_move_frigates)(struct game_state *game,
+                                       enum locations dest,
+                                       struct frigate_move *moves,
+                                       int *num_moves);
+    /* Brainbridge Supplies Intel, play or take discard pile card idx */
+    const char *(*choose_from_discard)(struct game_state *game, bool *play,
+                                       int *idx);
+    const char *(*sink_corsairs)(struct game_state *game, int count,
+                                 enum locations *locations,
+                                 int *num_locations);
+};
+
+extern const struct player terminal_player;
+extern const struct player random_player;
+
+#endif /* PLAYER_H */
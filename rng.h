@@ -0,0 +1,69 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/* xoshiro256** by Blackman and Vigna, one per game so games never share
+ * random state and replay the same from the same seed */
+struct rng {
+    uint64_t s[4];
+};
+
+static inline uint64_t rng_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/* Expand the seed with splitmix64 as recommended, it never produces an all
+ * zero state */
+static inline void rng_seed(struct rng *rng, uint64_t seed)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&seed);
+    }
+}
+
+static inline uint64_t rng_next(struct rng *rng)
+{
+    uint64_t *s = rng->s;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+
+    return result;
+}
+
+/* Unbiased value in [0, n) using Lemire's multiply and reject */
+static inline unsigned int rng_range(struct rng *rng, unsigned int n)
+{
+    uint64_t m = (rng_next(rng) >> 32) * n;
+    uint32_t threshold;
+
+    if ((uint32_t)m < n) {
+        threshold = -n % n;
+        while ((uint32_t)m < threshold) {
+            m = (rng_next(rng) >> 32) * n;
+        }
+    }
+
+    return m >> 32;
+}
+
+#endif /* RNG_H */
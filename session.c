@@ -0,0 +1,362 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "session.h"
+
+/* game_loop() only ever goes a few card plays and a battle deep, headless
+ * games never render so this is plenty. sot --check-sessions reports how much
+ * of it games really use */
+#define SESSION_STACK_SIZE (64 * 1024)
+/* Filled into the stack up front so the deepest use can be found afterwards */
+#define SESSION_STACK_FILL (0xa5)
+
+/* A game running on its own stack. Whenever the engine asks the US player for
+ * something the game switches back to whoever is driving it with the question
+ * and picks up from the same spot once it has an answer, so any number of
+ * games can be in flight on one thread */
+struct session {
+    struct game_state game;
+    ucontext_t caller_ctx;
+    ucontext_t game_ctx;
+    /* Mapping of the stack with an inaccessible guard page below it, so
+     * running off the end faults instead of writing over the heap */
+    void *mapping;
+    size_t guard_size;
+    unsigned char *stack;
+    bool started;
+    struct decision decision;
+    const struct decision_answer *answer;
+};
+
+static const struct player session_player;
+
+static struct session *game_session(struct game_state *game)
+{
+    return (struct session *)((char *)game - offsetof(struct session, game));
+}
+
+static struct decision *new_decision(struct game_state *game,
+                                     enum decision_type type)
+{
+    struct decision *decision = &game_session(game)->decision;
+
+    memset(decision, 0, sizeof(*decision));
+    decision->type = type;
+    decision->location = INVALID_LOCATION;
+    decision->zone = INVALID_ZONE;
+    decision->error = game->error;
+    game->error = NULL;
+
+    return decision;
+}
+
+/* Suspends the game until session_answer() */
+static const struct decision_answer *wait_answer(struct game_state *game)
+{
+    struct session *session = game_session(game);
+
+    swapcontext(&session->game_ctx, &session->caller_ctx);
+    return session->answer;
+}
+
+static const char *copy_moves(const struct decision_answer *answer,
+                              struct frigate_move *moves, int *num_moves,
+                              int max_moves)
+{
+    if (answer->num_moves < 0 || answer->num_moves > max_moves) {
+        return "Too many moves";
+    }
+
+    memcpy(moves, answer->moves, sizeof(*moves) * answer->num_moves);
+    *num_moves = answer->num_moves;
+
+    return NULL;
+}
+
+static const char *session_take_turn(struct game_state *game)
+{
+    const struct decision_answer *answer;
+
+    new_decision(game, DECIDE_TAKE_TURN);
+    answer = wait_answer(game);
+
+    return game_take_action(game, answer->action, answer->idx);
+}
+
+static const char *session_discard_down(struct game_state *game, int *idx)
+{
+    new_decision(game, DECIDE_DISCARD_DOWN);
+    *idx = wait_answer(game)->idx;
+
+    return NULL;
+}
+
+static const char *session_choose_battle(struct game_state *game,
+                                         enum locations *location)
+{
+    new_decision(game, DECIDE_CHOOSE_BATTLE);
+    *location = wait_answer(game)->location;
+
+    return NULL;
+}
+
+static bool session_play_battle_card(struct game_state *game,
+                                     struct card *card)
+{
+    new_decision(game, DECIDE_PLAY_BATTLE_CARD)->card = card;
+
+    return wait_answer(game)->yes;
+}
+
+static const char *session_assign_gunboats(struct game_state *game,
+                                           enum locations location,
+                                           enum zone zone, int *gunboats)
+{
+    struct decision *decision = new_decision(game, DECIDE_ASSIGN_GUNBOATS);
+
+    decision->location = location;
+    decision->zone = zone;
+    *gunboats = wait_answer(game)->gunboats;
+
+    return NULL;
+}
+
+static const char *session_assign_damage(struct game_state *game,
+                                         enum locations location,
+                                         enum zone zone, int num_hits,
+                                         enum battle_type btype,
+                                         struct damage_assignment *damage)
+{
+    struct decision *decision = new_decision(game, DECIDE_ASSIGN_DAMAGE);
+
+    decision->location = location;
+    decision->zone = zone;
+    decision->count = num_hits;
+    decision->btype = btype;
+    *damage = wait_answer(game)->damage;
+
+    return NULL;
+}
+
+static const char *session_move_frigates(struct game_state *game,
+                                         int allowed_moves,
+                                         struct frigate_move *moves,
+                                         int *num_moves)
+{
+    new_decision(game, DECIDE_MOVE_FRIGATES)->count = allowed_moves;
+
+    return copy_moves(wait_answer(game), moves, num_moves, MAX_FRIGATE_MOVES);
+}
+
+static const char *session_deploy_frigate(struct game_state *game,
+                                          enum locations *location)
+{
+    new_decision(game, DECIDE_DEPLOY_FRIGATE);
+    *location = wait_answer(game)->location;
+
+    return NULL;
+}
+
+static const char *session_show_of_force(struct game_state *game,
+                                         enum locations *ally,
+                                         struct frigate_move *moves,
+                                         int *num_moves)
+{
+    const struct decision_answer *answer;
+
+    new_decision(game, DECIDE_SHOW_OF_FORCE)->count = 3;
+    answer = wait_answer(game);
+    *ally = answer->location;
+
+    return copy_moves(answer, moves, num_moves, 3);
+}
+
+static const char *session_tribute_paid(struct game_state *game,
+                                        enum locations *ally,
+                                        struct frigate_move *move)
+{
+    const struct decision_answer *answer;
+
+    new_decision(game, DECIDE_TRIBUTE_PAID)->count = 1;
+    answer = wait_answer(game);
+    if (answer->num_moves != 1) {
+        return "Exactly one frigate must be moved";
+    }
+
+    *ally = answer->location;
+    *move = answer->moves[0];
+
+    return NULL;
+}
+
+static const char *session_hamet_move_frigates(struct game_state *game,
+                                               enum locations dest,
+                                               struct frigate_move *moves,
+                                               int *num_moves)
+{
+    struct decision *decision = new_decision(game,
+                                             DECIDE_HAMET_MOVE_FRIGATES);
+
+    decision->location = dest;
+    decision->count = 3;
+
+    return copy_moves(wait_answer(game), moves, num_moves, 3);
+}
+
+static const char *session_choose_from_discard(struct game_state *game,
+                                               bool *play, int *idx)
+{
+    const struct decision_answer *answer;
+
+    new_decision(game, DECIDE_CHOOSE_FROM_DISCARD);
+    answer = wait_answer(game);
+    *play = answer->yes;
+    *idx = answer->idx;
+
+    return NULL;
+}
+
+static const char *session_sink_corsairs(struct game_state *game, int count,
+                                         enum locations *locations,
+                                         int *num_locations)
+{
+    const struct decision_answer *answer;
+
+    new_decision(game, DECIDE_SINK_CORSAIRS)->count = count;
+    answer = wait_answer(game);
+    if (answer->num_locations < 0 || answer->num_locations > count) {
+        return "Too many locations provided";
+    }
+
+    memcpy(locations, answer->locations,
+           sizeof(*locations) * answer->num_locations);
+    *num_locations = answer->num_locations;
+
+    return NULL;
+}
+
+static const struct player session_player = {
+    .take_turn = session_take_turn,
+    .discard_down = session_discard_down,
+    .choose_battle = session_choose_battle,
+    .play_battle_card = session_play_battle_card,
+    .assign_gunboats = session_assign_gunboats,
+    .assign_damage = session_assign_damage,
+    .move_frigates = session_move_frigates,
+    .deploy_frigate = session_deploy_frigate,
+    .show_of_force = session_show_of_force,
+    .tribute_paid = session_tribute_paid,
+    .hamet_move_frigates = session_hamet_move_frigates,
+    .choose_from_discard = session_choose_from_discard,
+    .sink_corsairs = session_sink_corsairs,
+};
+
+/* makecontext() only passes ints so the session pointer comes in halves. When
+ * game_loop() returns uc_link switches back to the caller */
+static void session_main(unsigned int hi, unsigned int lo)
+{
+    struct session *session =
+        (struct session *)(uintptr_t)(((uint64_t)hi << 32) | lo);
+
+    game_loop(&session->game);
+}
+
+static const struct decision *session_resume(struct session *session)
+{
+    swapcontext(&session->caller_ctx, &session->game_ctx);
+
+    if (session->game.result != GAME_IN_PROGRESS) {
+        return NULL;
+    }
+    return &session->decision;
+}
+
+struct session *session_new(uint64_t seed)
+{
+    struct session *session = calloc(1, sizeof(*session));
+
+    if (session == NULL) {
+        return NULL;
+    }
+
+    session->guard_size = sysconf(_SC_PAGESIZE);
+    session->mapping = mmap(NULL, session->guard_size + SESSION_STACK_SIZE,
+                            PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (session->mapping == MAP_FAILED) {
+        free(session);
+        return NULL;
+    }
+    /* The stack grows down towards the guard */
+    mprotect(session->mapping, session->guard_size, PROT_NONE);
+    session->stack = (unsigned char *)session->mapping + session->guard_size;
+    memset(session->stack, SESSION_STACK_FILL, SESSION_STACK_SIZE);
+
+    init_game_state(&session->game, seed);
+    session->game.headless = true;
+    session->game.player = &session_player;
+
+    return session;
+}
+
+void session_free(struct session *session)
+{
+    if (session == NULL) {
+        return;
+    }
+
+    munmap(session->mapping, session->guard_size + SESSION_STACK_SIZE);
+    free(session);
+}
+
+struct game_state *session_game(struct session *session)
+{
+    return &session->game;
+}
+
+/* Deepest the game has gone into its stack so far, in bytes */
+size_t session_stack_used(struct session *session)
+{
+    size_t unused = 0;
+
+    while (unused < SESSION_STACK_SIZE &&
+           session->stack[unused] == SESSION_STACK_FILL) {
+        unused++;
+    }
+
+    return SESSION_STACK_SIZE - unused;
+}
+
+const struct decision *session_start(struct session *session)
+{
+    uint64_t ptr = (uintptr_t)session;
+
+    assert(!session->started);
+    session->started = true;
+
+    getcontext(&session->game_ctx);
+    session->game_ctx.uc_stack.ss_sp = session->stack;
+    session->game_ctx.uc_stack.ss_size = SESSION_STACK_SIZE;
+    session->game_ctx.uc_link = &session->caller_ctx;
+    makecontext(&session->game_ctx, (void (*)(void))session_main, 2,
+                (unsigned int)(ptr >> 32), (unsigned int)ptr);
+
+    return session_resume(session);
+}
+
+const struct decision *session_answer(struct session *session,
+                                      const struct decision_answer *answer)
+{
+    assert(session->started);
+
+    if (session->game.result != GAME_IN_PROGRESS) {
+        return NULL;
+    }
+
+    session->answer = answer;
+    return session_resume(session);
+}
@@ -0,0 +1,68 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "cards.h"
+#include "game.h"
+#include "player.h"
+
+/* One per player callback, see player.h for what each one is asking */
+enum decision_type {
+    DECIDE_TAKE_TURN,
+    DECIDE_DISCARD_DOWN,
+    DECIDE_CHOOSE_BATTLE,
+    DECIDE_PLAY_BATTLE_CARD,
+    DECIDE_ASSIGN_GUNBOATS,
+    DECIDE_ASSIGN_DAMAGE,
+    DECIDE_MOVE_FRIGATES,
+    DECIDE_DEPLOY_FRIGATE,
+    DECIDE_SHOW_OF_FORCE,
+    DECIDE_TRIBUTE_PAID,
+    DECIDE_HAMET_MOVE_FRIGATES,
+    DECIDE_CHOOSE_FROM_DISCARD,
+    DECIDE_SINK_CORSAIRS
+};
+
+/* The question a suspended game is waiting on */
+struct decision {
+    enum decision_type type;
+    /* Why the last answer was rejected, NULL if it wasn't */
+    const char *error;
+    enum locations location;
+    enum zone zone;
+    enum battle_type btype;
+    /* Allowed moves, hits to assign or corsairs to sink */
+    int count;
+    struct card *card;
+};
+
+/* Only the fields for the pending decision type are read */
+struct decision_answer {
+    /* DECIDE_TAKE_TURN */
+    enum us_action action;
+    /* Card for the turn action, discarding down or the discard pile */
+    int idx;
+    /* Play the battle card, or play rather than take from the discard pile */
+    bool yes;
+    /* Battle, deploy or ally location */
+    enum locations location;
+    int gunboats;
+    struct damage_assignment damage;
+    struct frigate_move moves[MAX_FRIGATE_MOVES];
+    int num_moves;
+    enum locations locations[2];
+    int num_locations;
+};
+
+struct session;
+
+struct session *session_new(uint64_t seed);
+void session_free(struct session *session);
+struct game_state *session_game(struct session *session);
+size_t session_stack_used(struct session *session);
+/* Runs the game up to its first decision. Like session_answer() this returns
+ * NULL once the game is over and game->result says how it ended */
+const struct decision *session_start(struct session *session);
+const struct decision *session_answer(struct session *session,
+                                      const struct decision_answer *answer);
+
+#endif /* SESSION_H */
@@ -0,0 +1,590 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "cards.h"
+#include "game.h"
+#include "player.h"
+#include "session.h"
+#include "sim.h"
+
+/* Moves up to count frigates one at a time from random occupied slots. If dest
+ * is valid every frigate goes to its harbor, otherwise each picks a random
+ * harbor or patrol zone */
+static int random_moves(struct game_state *game, struct frigate_move *moves,
+                        int count, enum locations dest)
+{
+    unsigned int frigates[FRIGATE_SLOTS];
+    unsigned int total = 0;
+    int num_moves;
+    int from;
+    int to;
+    int r;
+
+    for (from = 0; from < FRIGATE_SLOTS; from++) {
+        frigates[from] = *slot_frigates(game, from);
+        total += frigates[from];
+    }
+
+    count = min(count, total);
+    for (num_moves = 0; num_moves < count; num_moves++) {
+        r = rng_range(&game->rng, total);
+        for (from = 0; r >= frigates[from]; from++) {
+            r -= frigates[from];
+        }
+        frigates[from]--;
+        total--;
+
+        to = (dest == INVALID_LOCATION) ? rng_range(&game->rng, FRIGATE_SLOTS) :
+            dest;
+
+        moves[num_moves].from = slot_location(from);
+        moves[num_moves].from_zone = slot_zone(from);
+        moves[num_moves].to = slot_location(to);
+        moves[num_moves].to_zone = slot_zone(to);
+        moves[num_moves].quantity = 1;
+    }
+
+    return num_moves;
+}
+
+static enum locations random_active_ally(struct game_state *game)
+{
+    enum locations ally;
+
+    do {
+        ally = rng_range(&game->rng, TRIP_ALLIES);
+    } while (game->t_allies[ally] == 0);
+
+    return ally;
+}
+
+/* Picks uniformly between every playable card and every discard option */
+static void random_turn_action(struct game_state *game,
+                               enum us_action *action, int *idx)
+{
+    struct {
+        enum us_action action;
+        int idx;
+    } options[US_DECK_SIZE * 3 + US_CORE_CARD_COUNT];
+    int num_options = 0;
+    int i;
+
+    for (i = 0; i < hand_size(game); i++) {
+        if (hand_card_playable(game, i)) {
+            options[num_options].action = US_PLAY_CARD;
+            options[num_options++].idx = i;
+        }
+        if (game->us_gunboats < MAX_GUNBOATS) {
+            options[num_options].action = US_BUILD_GUNBOAT;
+            options[num_options++].idx = i;
+        }
+        options[num_options].action = US_MOVE_FRIGATES;
+        options[num_options++].idx = i;
+    }
+
+    for (i = 0; i < mask_count(game->us_core); i++) {
+        if (core_card_playable(game, i)) {
+            options[num_options].action = US_PLAY_CORE;
+            options[num_options++].idx = i;
+        }
+    }
+
+    /* Nothing left to do, let the turn pass */
+    if (num_options == 0) {
+        *action = US_PASS;
+        *idx = 0;
+        return;
+    }
+
+    i = rng_range(&game->rng, num_options);
+    *action = options[i].action;
+    *idx = options[i].idx;
+}
+
+static const char *random_take_turn(struct game_state *game)
+{
+    enum us_action action;
+    int idx;
+
+    random_turn_action(game, &action, &idx);
+    return game_take_action(game, action, idx);
+}
+
+static const char *random_discard_down(struct game_state *game, int *idx)
+{
+    *idx = rng_range(&game->rng, hand_size(game));
+    return NULL;
+}
+
+static const char *random_choose_battle(struct game_state *game,
+                                        enum locations *location)
+{
+    int i;
+
+    for (i = 0; i < NUM_LOCATIONS; i++) {
+        if (location_battle(game, i) != BTYPE_NONE) {
+            *location = i;
+            return NULL;
+        }
+    }
+
+    *location = INVALID_LOCATION;
+    return NULL;
+}
+
+static bool random_play_battle_card(struct game_state *game,
+                                    struct card *card)
+{
+    return true;
+}
+
+static const char *random_assign_gunboats(struct game_state *game,
+                                          enum locations location,
+                                          enum zone zone, int *gunboats)
+{
+    *gunboats = game->us_gunboats - game->used_gunboats;
+    return NULL;
+}
+
+/* Damage frigates first since they come back next year, then lose gunboats and
+ * only destroy frigates when there is nothing else left to take the hits */
+static const char *random_assign_damage(struct game_state *game,
+                                        enum locations location,
+                                        enum zone zone, int num_hits,
+                                        enum battle_type btype,
+                                        struct damage_assignment *damage)
+{
+    int idx;
+    int frigates;
+    int rem;
+
+    if (btype == GROUND_BATTLE) {
+        idx = us_infantry_idx(location);
+        damage->destroy_arabs = min(num_hits, game->arab_infantry[idx]);
+        damage->destroy_marines = num_hits - damage->destroy_arabs;
+        return NULL;
+    }
+
+    frigates = *us_frigate_ptr(game, location, zone) +
+        game->us_damaged_frigates;
+    damage->damage_frigates = min(num_hits, frigates);
+    rem = num_hits - damage->damage_frigates;
+    if (rem > 0) {
+        damage->destroy_gunboats = min(rem, game->assigned_gunboats);
+        damage->destroy_frigates = rem - damage->destroy_gunboats;
+        damage->damage_frigates -= damage->destroy_frigates;
+    }
+
+    return NULL;
+}
+
+static const char *random_move_frigates(struct game_state *game,
+                                        int allowed_moves,
+                                        struct frigate_move *moves,
+                                        int *num_moves)
+{
+    *num_moves = random_moves(game, moves,
+                              rng_range(&game->rng, allowed_moves + 1),
+                              INVALID_LOCATION);
+    return NULL;
+}
+
+static const char *random_deploy_frigate(struct game_state *game,
+                                         enum locations *location)
+{
+    *location = rng_range(&game->rng, PATROL_ZONES);
+    return NULL;
+}
+
+static const char *random_show_of_force(struct game_state *game,
+                                        enum locations *ally,
+                                        struct frigate_move *moves,
+                                        int *num_moves)
+{
+    *ally = random_active_ally(game);
+    *num_moves = random_moves(game, moves, 3, *ally);
+    return NULL;
+}
+
+static const char *random_tribute_paid(struct game_state *game,
+                                       enum locations *ally,
+                                       struct frigate_move *move)
+{
+    *ally = random_active_ally(game);
+    if (random_moves(game, move, 1, *ally) == 0) {
+        return "No frigates at location to move";
+    }
+    return NULL;
+}
+
+static const char *random_hamet_move_frigates(struct game_state *game,
+                                              enum locations dest,
+                                              struct frigate_move *moves,
+                                              int *num_moves)
+{
+    *num_moves = random_moves(game, moves, rng_range(&game->rng, 4), dest);
+    return NULL;
+}
+
+static const char *random_choose_from_discard(struct game_state *game,
+                                              bool *play, int *idx)
+{
+    *play = false;
+    *idx = rng_range(&game->rng, discard_size(game));
+    return NULL;
+}
+
+/* Tripoli first, the corsairs there are the ones raiding */
+static const char *random_sink_corsairs(struct game_state *game, int count,
+                                        enum locations *locations,
+                                        int *num_locations)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        locations[i] = (game->t_corsairs_tripoli > i) ? TRIPOLI : GIBRALTAR;
+    }
+    *num_locations = count;
+
+    return NULL;
+}
+
+/* Headless US player, chooses uniformly at random where there's a real choice
+ * and takes the obvious answer everywhere else */
+const struct player random_player = {
+    .take_turn = random_take_turn,
+    .discard_down = random_discard_down,
+    .choose_battle = random_choose_battle,
+    .play_battle_card = random_play_battle_card,
+    .assign_gunboats = random_assign_gunboats,
+    .assign_damage = random_assign_damage,
+    .move_frigates = random_move_frigates,
+    .deploy_frigate = random_deploy_frigate,
+    .show_of_force = random_show_of_force,
+    .tribute_paid = random_tribute_paid,
+    .hamet_move_frigates = random_hamet_move_frigates,
+    .choose_from_discard = random_choose_from_discard,
+    .sink_corsairs = random_sink_corsairs,
+};
+
+static enum game_result play_headless_game(struct game_state *game,
+                                           uint64_t seed)
+{
+    /* Seed 0 means a time based seed, skip over it on wraparound */
+    init_game_state(game, seed ? seed : 1);
+    game->headless = true;
+    game->player = &random_player;
+
+    return game_loop(game);
+}
+
+static const char *result_str(enum game_result result)
+{
+    switch (result) {
+        case GAME_DRAW:
+            return "Draw";
+        case TRIPOLI_GOLD_WIN:
+            return "Tripoli win (gold)";
+        case TRIPOLI_FRIGATES_WIN:
+            return "Tripoli win (frigates destroyed)";
+        case US_TREATY_WIN:
+            return "US win (peace treaty)";
+        case US_ASSAULT_WIN:
+            return "US win (assault on Tripoli)";
+        case US_ASSAULT_FAILED:
+            return "Tripoli win (assault failed)";
+        default:
+            assert(false);
+            return "";
+    }
+}
+
+/* Answers a session the same way random_player answers the matching callback,
+ * drawing the same random numbers */
+static void random_answer(struct game_state *game,
+                          const struct decision *decision,
+                          struct decision_answer *answer)
+{
+    memset(answer, 0, sizeof(*answer));
+
+    switch (decision->type) {
+        case DECIDE_TAKE_TURN:
+            random_turn_action(game, &answer->action, &answer->idx);
+            break;
+        case DECIDE_DISCARD_DOWN:
+            random_discard_down(game, &answer->idx);
+            break;
+        case DECIDE_CHOOSE_BATTLE:
+            random_choose_battle(game, &answer->location);
+            break;
+        case DECIDE_PLAY_BATTLE_CARD:
+            answer->yes = random_play_battle_card(game, decision->card);
+            break;
+        case DECIDE_ASSIGN_GUNBOATS:
+            random_assign_gunboats(game, decision->location, decision->zone,
+                                   &answer->gunboats);
+            break;
+        case DECIDE_ASSIGN_DAMAGE:
+            random_assign_damage(game, decision->location, decision->zone,
+                                 decision->count, decision->btype,
+                                 &answer->damage);
+            break;
+        case DECIDE_MOVE_FRIGATES:
+            random_move_frigates(game, decision->count, answer->moves,
+                                 &answer->num_moves);
+            break;
+        case DECIDE_DEPLOY_FRIGATE:
+            random_deploy_frigate(game, &answer->location);
+            break;
+        case DECIDE_SHOW_OF_FORCE:
+            random_show_of_force(game, &answer->location, answer->moves,
+                                 &answer->num_moves);
+            break;
+        case DECIDE_TRIBUTE_PAID:
+            /* No move at all gets the answer rejected like the error does */
+            if (random_tribute_paid(game, &answer->location,
+                                    answer->moves) == NULL) {
+                answer->num_moves = 1;
+            }
+            break;
+        case DECIDE_HAMET_MOVE_FRIGATES:
+            random_hamet_move_frigates(game, decision->location,
+                                       answer->moves, &answer->num_moves);
+            break;
+        case DECIDE_CHOOSE_FROM_DISCARD:
+            random_choose_from_discard(game, &answer->yes, &answer->idx);
+            break;
+        case DECIDE_SINK_CORSAIRS:
+            random_sink_corsairs(game, decision->count, answer->locations,
+                                 &answer->num_locations);
+            break;
+    }
+}
+
+/* Plays each game straight through with random_player and again through a
+ * session answered the same way. Both draw the same random numbers, so they
+ * have to end the same. Returns how many didn't */
+unsigned long sim_check_sessions(unsigned long games, uint64_t seed)
+{
+    struct game_state game;
+    struct game_state *session_state;
+    struct session *session;
+    const struct decision *decision;
+    struct decision_answer answer;
+    enum game_result result;
+    unsigned long mismatches = 0;
+    size_t stack_used = 0;
+    unsigned long i;
+
+    for (i = 0; i < games; i++) {
+        result = play_headless_game(&game, seed + i);
+
+        /* Same seed as play_headless_game() */
+        session = session_new((seed + i) ? seed + i : 1);
+        if (session == NULL) {
+            fprintf(stderr, "Not enough memory for a session\n");
+            return mismatches + 1;
+        }
+
+        decision = session_start(session);
+        while (decision != NULL) {
+            random_answer(session_game(session), decision, &answer);
+            decision = session_answer(session, &answer);
+        }
+
+        session_state = session_game(session);
+        if (session_state->result != result ||
+            session_state->year != game.year ||
+            session_state->season != game.season) {
+            printf("Seed %" PRIu64 ": %s in %d headless, %s in %d through a "
+                   "session\n", seed + i, result_str(result), game.year,
+                   result_str(session_state->result), session_state->year);
+            mismatches++;
+        }
+
+        if (session_stack_used(session) > stack_used) {
+            stack_used = session_stack_used(session);
+        }
+        session_free(session);
+    }
+
+    printf("%lu games, %lu ended differently through a session\n", games,
+           mismatches);
+    printf("Deepest session stack use %zu bytes\n", stack_used);
+
+    return mismatches;
+}
+
+/* Games handed out to a worker at a time, small enough that stealing
+ * balances the tail and large enough that the locks never show up */
+#define SIM_CHUNK (64)
+
+struct sim_worker {
+    pthread_t thread;
+    /* Remaining games [next, end) owned by this worker, thieves take the back
+     * half under the lock */
+    pthread_mutex_t lock;
+    unsigned long next;
+    unsigned long end;
+    /* Only written once the worker is done, thieves write the fields above
+     * while it plays */
+    unsigned long results[NUM_GAME_RESULTS];
+    struct sim_pool *pool;
+};
+
+struct sim_pool {
+    struct sim_worker *workers;
+    int num_workers;
+    uint64_t seed;
+};
+
+static bool sim_take_chunk(struct sim_worker *worker, unsigned long *lo,
+                           unsigned long *hi)
+{
+    pthread_mutex_lock(&worker->lock);
+    *lo = worker->next;
+    *hi = (worker->end - *lo > SIM_CHUNK) ? *lo + SIM_CHUNK : worker->end;
+    worker->next = *hi;
+    pthread_mutex_unlock(&worker->lock);
+
+    return *lo < *hi;
+}
+
+/* Takes the back half of the first victim that still has work. No new work is
+ * ever created so once every range is empty the worker is done */
+static bool sim_steal(struct sim_worker *thief)
+{
+    struct sim_pool *pool = thief->pool;
+    struct sim_worker *victim;
+    unsigned long lo = 0, hi = 0;
+    int self = thief - pool->workers;
+    int i;
+
+    for (i = 1; i < pool->num_workers && lo == hi; i++) {
+        victim = &pool->workers[(self + i) % pool->num_workers];
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->next < victim->end) {
+            hi = victim->end;
+            lo = victim->end - (victim->end - victim->next + 1) / 2;
+            victim->end = lo;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    if (lo == hi) {
+        return false;
+    }
+
+    pthread_mutex_lock(&thief->lock);
+    thief->next = lo;
+    thief->end = hi;
+    pthread_mutex_unlock(&thief->lock);
+
+    return true;
+}
+
+static void *sim_worker_run(void *arg)
+{
+    struct sim_worker *worker = arg;
+    uint64_t seed = worker->pool->seed;
+    struct game_state game;
+    /* Counted locally so no other thread's cache line is written per game */
+    unsigned long results[NUM_GAME_RESULTS] = { 0 };
+    unsigned long lo, hi;
+
+    /* One state per worker, reset in place for every game */
+    do {
+        while (sim_take_chunk(worker, &lo, &hi)) {
+            for (; lo < hi; lo++) {
+                results[play_headless_game(&game, seed + lo)]++;
+            }
+        }
+    } while (sim_steal(worker));
+
+    memcpy(worker->results, results, sizeof(results));
+    return NULL;
+}
+
+/* Game i is always played from seed + i so the totals are the same for any
+ * number of threads */
+void sim_run(unsigned long games, uint64_t seed, int threads)
+{
+    unsigned long results[NUM_GAME_RESULTS] = { 0 };
+    struct sim_pool pool;
+    struct sim_worker *worker;
+    unsigned long per_worker;
+    unsigned long i;
+    struct timespec start, end;
+    double elapsed;
+    unsigned long us_wins;
+    unsigned long tripoli_wins;
+    int j;
+
+    if (seed == 0) {
+        seed = time(NULL);
+    }
+
+    pool.seed = seed;
+    pool.num_workers = threads;
+    pool.workers = calloc(threads, sizeof(*pool.workers));
+    if (pool.workers == NULL) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Start from an even split, stealing takes care of the uneven game
+     * lengths */
+    per_worker = games / threads;
+    for (j = 0; j < threads; j++) {
+        worker = &pool.workers[j];
+        pthread_mutex_init(&worker->lock, NULL);
+        worker->next = j * per_worker;
+        worker->end = (j == threads - 1) ? games : worker->next + per_worker;
+        worker->pool = &pool;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (j = 0; j < threads; j++) {
+        if (pthread_create(&pool.workers[j].thread, NULL, sim_worker_run,
+                           &pool.workers[j]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (j = 0; j < threads; j++) {
+        worker = &pool.workers[j];
+        pthread_join(worker->thread, NULL);
+        pthread_mutex_destroy(&worker->lock);
+        for (i = 0; i < NUM_GAME_RESULTS; i++) {
+            results[i] += worker->results[i];
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (end.tv_sec - start.tv_sec) +
+        (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    free(pool.workers);
+
+    printf("Simulated %lu games from seed %" PRIu64 " on %d threads\n", games,
+           seed, threads);
+    for (i = GAME_IN_PROGRESS + 1; i < NUM_GAME_RESULTS; i++) {
+        printf("%-34s %10lu (%5.1f%%)\n", result_str(i), results[i],
+               games ? 100.0 * results[i] / games : 0.0);
+    }
+
+    us_wins = results[US_TREATY_WIN] + results[US_ASSAULT_WIN];
+    tripoli_wins = results[TRIPOLI_GOLD_WIN] + results[TRIPOLI_FRIGATES_WIN] +
+        results[US_ASSAULT_FAILED];
+    printf("US wins %lu, Tripoli wins %lu, draws %lu\n", us_wins, tripoli_wins,
+           results[GAME_DRAW]);
+    printf("%.2f seconds, %.1f games/sec, %.1f games/sec/thread\n", elapsed,
+           elapsed > 0 ? games / elapsed : 0.0,
+           elapsed > 0 ? games / elapsed / threads : 0.0);
+}
@@ -0,0 +1,9 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+void sim_run(unsigned long games, uint64_t seed, int threads);
+unsigned long sim_check_sessions(unsigned long games, uint64_t seed);
+
+#endif /* SIM_H */
@@ -1,25 +1,37 @@
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "cards.h"
 #include "game.h"
 
 /* 4 cards that can be added to the end of the event line */
-#define TBOT_EVENT_MAX (8)
 #define TBOT_EVENT_ADD_IDX (4)
 
 #define array_size(arr) (sizeof(arr) / sizeof(arr[0]))
 
+/* A line that doesn't fit is cut short and leaves the log full, ptr never
+ * moves past the terminating NUL */
 #define tbot_log_append(game, ...)                                      \
-    game->log_ptr +=                                                    \
-        snprintf(game->log_ptr,                                         \
-                 TBOT_LOG_LEN - (game->log_ptr - game->tbot_log),       \
-                 __VA_ARGS__);
+    do {                                                                \
+        struct tbot_log *log_ = (game)->log;                            \
+        size_t left_;                                                   \
+        int len_;                                                       \
+                                                                        \
+        if (log_ != NULL) {                                             \
+            left_ = TBOT_LOG_LEN - (log_->ptr - log_->text);            \
+            len_ = snprintf(log_->ptr, left_, __VA_ARGS__);             \
+            if (len_ > 0) {                                             \
+                log_->ptr += ((size_t)len_ < left_) ? (size_t)len_ :    \
+                    left_ - 1;                                          \
+            }                                                           \
+        }                                                               \
+    } while (0)
 
 static void activate_ally(struct game_state *game, enum locations location)
 {
     assert(location < TRIP_ALLIES);
-    game->t_allies[location] = 3;
+    game_set(game, game->t_allies[location], 3);
 }
 
 static void pirate_raid(struct game_state *game, enum locations location);
@@ -40,14 +52,14 @@ static void apply_damage(struct game_state *game, enum locations location,
     if (has_trip_allies(location)) {
         assert(btype == NAVAL_BATTLE);
         hits = min(hits, game->t_allies[location]);
-        game->t_allies[location] -= hits;
+        game_sub(game, game->t_allies[location], hits);
         return;
     }
 
     if (btype == GROUND_BATTLE) {
         idx = trip_infantry_idx(location);
         hits = min(hits, game->t_infantry[idx]);
-        game->t_infantry[idx] -= hits;
+        game_sub(game, game->t_infantry[idx], hits);
         return;
     }
 
@@ -58,19 +70,19 @@ static void apply_damage(struct game_state *game, enum locations location,
         /* First damage frigates before destroying corsairs */
         apply_hits = min(hits, game->t_frigates);
         hits -= apply_hits;
-        game->t_frigates -= apply_hits;
-        game->t_damaged_frigates += apply_hits;
+        game_sub(game, game->t_frigates, apply_hits);
+        game_add(game, game->t_damaged_frigates, apply_hits);
         assert(hits >= 0 && game->t_frigates >= 0);
 
         /* Next destroy corsairs */
         apply_hits = min(hits, game->t_corsairs_tripoli);
-        game->t_corsairs_tripoli -= apply_hits;
+        game_sub(game, game->t_corsairs_tripoli, apply_hits);
         hits -= apply_hits;
         assert(hits >= 0 && game->t_corsairs_tripoli >= 0);
 
         /* Final resort, destroy damaged frigates */
         apply_hits = min(hits, game->t_damaged_frigates);
-        game->t_damaged_frigates -= apply_hits;
+        game_sub(game, game->t_damaged_frigates, apply_hits);
         assert(game->t_damaged_frigates >= 0);
 
         /* If we're not in the final battle the frigates will stick around until
@@ -78,37 +90,39 @@ static void apply_damage(struct game_state *game, enum locations location,
          */
         if (!game->victory_or_death) {
             if (game->year < END_YEAR) {
-                game->t_turn_frigates[year_to_frigate_idx(game->year + 1)] +=
-                    game->t_damaged_frigates;
+                game_add(game, game->t_turn_frigates[
+                             year_to_frigate_idx(game->year + 1)],
+                         game->t_damaged_frigates);
             }
-            game->t_damaged_frigates = 0;
+            game_set(game, game->t_damaged_frigates, 0);
         }
     } else if (game->year == 1805 || game->year == 1806) {
         /* Destroy corsairs first */
         apply_hits = min(hits, game->t_corsairs_tripoli);
         hits -= apply_hits;
-        game->t_corsairs_tripoli -= apply_hits;
+        game_sub(game, game->t_corsairs_tripoli, apply_hits);
 
         assert(hits >= 0 && game->t_corsairs_tripoli >= 0);
 
         /* Damage frigates */
         apply_hits = min(hits, game->t_frigates);
         hits -= apply_hits;
-        game->t_frigates -= apply_hits;
-        game->t_damaged_frigates += apply_hits;
+        game_sub(game, game->t_frigates, apply_hits);
+        game_add(game, game->t_damaged_frigates, apply_hits);
 
         assert(hits >= 0 && game->t_frigates >= 0);
 
         /* Destroy frigates when theres no other option */
         apply_hits -= min(hits, game->t_damaged_frigates);
-        game->t_damaged_frigates -= apply_hits;
+        game_sub(game, game->t_damaged_frigates, apply_hits);
 
         assert(game->t_damaged_frigates >= 0);
 
         /* Any frigates not destroyed ship em off to get repaired */
         if (game->year < END_YEAR) {
-            game->t_turn_frigates[year_to_frigate_idx(game->year + 1)] +=
-                game->t_damaged_frigates;
+            game_add(game,
+                     game->t_turn_frigates[year_to_frigate_idx(game->year + 1)],
+                     game->t_damaged_frigates);
         }
     } else {
         /* Unreachable */
@@ -167,7 +181,7 @@ struct card mercenaries_desert = {
     "to the Supply"
 };
 
-static struct card *tbot_battle_cards[] = {
+static struct card *const tbot_battle_cards[TBOT_BATTLE_CARD_COUNT] = {
     &books_overboard,
     &uncharted_waters,
     &merchant_ship_converted,
@@ -182,8 +196,10 @@ static bool tbot_check_play_battle_card(struct game_state *game,
     int i;
 
     for (i = 0; i < array_size(tbot_battle_cards); i++) {
-        if (tbot_battle_cards[i] == card) {
-            tbot_battle_cards[i] = NULL;
+        if (tbot_battle_cards[i] == card &&
+            (game->tbot_battle_cards & (1u << i))) {
+            game_set(game, game->tbot_battle_cards,
+                     game->tbot_battle_cards & ~(1u << i));
             tbot_log_append(game, "T-Bot plays [%s] as a battle card\n",
                             card->name);
             return true;
@@ -193,6 +209,28 @@ static bool tbot_check_play_battle_card(struct game_state *game,
     return false;
 }
 
+bool tbot_holds_battle_card(struct game_state *game, struct card *card)
+{
+    int i;
+
+    for (i = 0; i < array_size(tbot_battle_cards); i++) {
+        if (tbot_battle_cards[i] == card) {
+            return game->tbot_battle_cards & (1u << i);
+        }
+    }
+
+    return false;
+}
+
+/* The T-Bot plays The Guns of Tripoli in the first naval battle in Tripoli
+ * harbor from summer 1805 on, or in the Assault on Tripoli */
+bool tbot_guns_of_tripoli_ready(struct game_state *game)
+{
+    return ((game->year == 1805 && game->season != WINTER) ||
+            game->year == 1806 || game->victory_or_death) &&
+        tbot_holds_battle_card(game, &the_guns_of_tripoli);
+}
+
 static bool yusuf_playable(struct game_state *game)
 {
     int ally_count = 0;
@@ -245,8 +283,8 @@ static const char *play_break_out(struct game_state *game)
 {
     game_handle_intercept(game, GIBRALTAR);
 
-    game->t_corsairs_tripoli += game->t_corsairs_gibraltar;
-    game->t_corsairs_gibraltar = 0;
+    game_add(game, game->t_corsairs_tripoli, game->t_corsairs_gibraltar);
+    game_set(game, game->t_corsairs_gibraltar, 0);
 
     return NULL;
 }
@@ -269,9 +307,9 @@ static bool send_aid_playable(struct game_state *game)
 
 static const char *play_send_aid(struct game_state *game)
 {
-    game->t_frigates++;
-    game->t_corsairs_tripoli += 2;
-    game->t_infantry[trip_infantry_idx(TRIPOLI)] += 2;
+    game_add(game, game->t_frigates, 1);
+    game_add(game, game->t_corsairs_tripoli, 2);
+    game_add(game, game->t_infantry[trip_infantry_idx(TRIPOLI)], 2);
 
     return NULL;
 }
@@ -301,8 +339,8 @@ static const char *play_supplies_run_low(struct game_state *game)
      * know
      */
 
-    game->patrol_frigates[TRIPOLI]--;
-    game->us_frigates[MALTA]++;
+    game_sub(game, game->patrol_frigates[TRIPOLI], 1);
+    game_add(game, game->us_frigates[MALTA], 1);
 
     return NULL;
 }
@@ -363,7 +401,7 @@ static bool troops_to_derne_playable(struct game_state *game)
 
 static const char *play_troops_to_derne(struct game_state *game)
 {
-    game->t_infantry[trip_infantry_idx(DERNE)] += 2;
+    game_add(game, game->t_infantry[trip_infantry_idx(DERNE)], 2);
     return NULL;
 }
 
@@ -383,7 +421,7 @@ static bool troops_to_benghazi_playable(struct game_state *game)
 
 static const char *play_troops_to_benghazi(struct game_state *game)
 {
-    game->t_infantry[trip_infantry_idx(BENGHAZI)] += 2;
+    game_add(game, game->t_infantry[trip_infantry_idx(BENGHAZI)], 2);
     return NULL;
 }
 
@@ -398,7 +436,7 @@ struct card troops_to_benghazi = {
 
 static const char *play_troops_to_tripoli(struct game_state *game)
 {
-    game->t_infantry[trip_infantry_idx(TRIPOLI)] += 2;
+    game_add(game, game->t_infantry[trip_infantry_idx(TRIPOLI)], 2);
     return NULL;
 }
 
@@ -456,7 +494,7 @@ static const char *play_storms(struct game_state *game)
 
     assert(max_score != -1);
 
-    score_count = rand() % score_count + 1;
+    score_count = rng_range(&game->rng, score_count) + 1;
 
     for (i = 0; i < PATROL_ZONES; i++) {
         if (scores[i] == max_score) {
@@ -470,18 +508,19 @@ static const char *play_storms(struct game_state *game)
     assert(score_idx != -1);
 
     rolls = game->patrol_frigates[score_idx];
-    successes = rolld6s(rolls, 6);
+    successes = rolld6s(game, rolls, 6);
 
     if (successes > 0) {
-        game->patrol_frigates[score_idx]--;
-        game->destroyed_us_frigates++;
+        game_sub(game, game->patrol_frigates[score_idx], 1);
+        game_add(game, game->destroyed_us_frigates, 1);
         successes--;
     }
 
-    game->patrol_frigates[score_idx] -= successes;
+    game_sub(game, game->patrol_frigates[score_idx], successes);
     if (game->year < END_YEAR) {
-        game->turn_track_frigates[year_to_frigate_idx(game->year + 1)] +=
-            successes;
+        game_add(game,
+                 game->turn_track_frigates[year_to_frigate_idx(game->year + 1)],
+                 successes);
     }
 
     return NULL;
@@ -516,17 +555,18 @@ static const char *play_tripoli_attacks(struct game_state *game)
     int us_dice = (prebles_boys_played) ? 3 : FRIGATE_DICE; /* only 1 ship in
                                                               * the zone */
     int trip_dice = game->t_corsairs_tripoli + game->t_frigates * FRIGATE_DICE;
-    int us_success = rolld6s(us_dice, 6);;
-    int trip_success = rolld6s(trip_dice, 6);;
+    int us_success = rolld6s(game, us_dice, 6);;
+    int trip_success = rolld6s(game, trip_dice, 6);;
 
     if (trip_success >= 1) {
-        game->patrol_frigates[TRIPOLI]--;
+        game_sub(game, game->patrol_frigates[TRIPOLI], 1);
         if (trip_success == 1) {
             if (game->year < END_YEAR) {
-                game->turn_track_frigates[year_to_frigate_idx(game->year + 1)]++;
+                game_add(game, game->turn_track_frigates[
+                             year_to_frigate_idx(game->year + 1)], 1);
             }
         } else if (trip_success >= 2) {
-            game->destroyed_us_frigates++;
+            game_add(game, game->destroyed_us_frigates, 1);
         }
     }
 
@@ -555,8 +595,8 @@ static bool sweden_pays_tribute_playable(struct game_state *game)
 
 static const char *play_sweden_pays_tribute(struct game_state *game)
 {
-    game->swedish_frigates_active = false;
-    game->pirated_gold += 2;
+    game_set(game, game->swedish_frigates_active, false);
+    game_add(game, game->pirated_gold, 2);
 
     return NULL;
 }
@@ -581,7 +621,7 @@ static bool acquire_corsairs_playable(struct game_state *game)
 
 static const char *play_tripoli_acquires_corsairs(struct game_state *game)
 {
-    game->t_corsairs_tripoli += 2;
+    game_add(game, game->t_corsairs_tripoli, 2);
     return NULL;
 }
 
@@ -600,22 +640,18 @@ static bool philly_runs_aground_playable(struct game_state *game)
 
 static const char *play_philly_runs_aground(struct game_state *game)
 {
-    int roll = rolld6();
     bool uncharted_waters_played =
         tbot_check_play_battle_card(game, &uncharted_waters);
-
-    if (uncharted_waters_played) {
-        roll = max(roll, rolld6());
-    }
+    int roll = rolld6_best(game, (uncharted_waters_played) ? 2 : 1);
 
     switch (roll) {
         case 5:
         case 6:
-            game->t_frigates++;
+            game_add(game, game->t_frigates, 1);
         case 3:
         case 4:
-            game->patrol_frigates[TRIPOLI]--;
-            game->destroyed_us_frigates++;
+            game_sub(game, game->patrol_frigates[TRIPOLI], 1);
+            game_add(game, game->destroyed_us_frigates, 1);
     }
 
     return NULL;
@@ -691,15 +727,11 @@ struct card second_storms = {
     .play = play_storms
 };
 
-/* We leave the last 2 slots open for Storms and Second Storms */
-static struct card *tbot_event_line[TBOT_EVENT_MAX] = {
-    &yusuf_qaramanli,
-    &murad_reis_breaks_out,
-    &constantinople_sends_aid,
-    &sweden_pays_tribute
-};
-
-static struct card *tbot_deck[] = {
+/* Every T-Bot card that can be drawn or sit on the event line, a card's id is
+ * its index. The deck comes first */
+#define TBOT_EVENT_START (TBOT_DECK_SIZE)
+static struct card *const tbot_cards[] = {
+    /* Deck */
     &us_supplies_run_low,
     &algerine_corsairs_raid, &algerine_corsairs_raid,
     &moroccan_corsairs_raid, &moroccan_corsairs_raid,
@@ -708,10 +740,18 @@ static struct card *tbot_deck[] = {
     &storms, &tripoli_attacks, &tripoli_acquires_corsairs,
     &philly_runs_aground,
     &algiers_declares_war, &morocco_declares_war, &tunis_declares_war,
-    &second_storms
+    &second_storms,
+
+    /* Starting event line, we leave the last slots open for Storms and
+     * Second Storms */
+    &yusuf_qaramanli,
+    &murad_reis_breaks_out,
+    &constantinople_sends_aid,
+    &sweden_pays_tribute
 };
 
-static unsigned int tbot_deck_size = array_size(tbot_deck);
+_Static_assert(array_size(tbot_cards) == TBOT_EVENT_START + TBOT_EVENT_ADD_IDX,
+               "every starting event line card needs an id");
 
 int tbot_resolve_naval_battle(struct game_state *game, enum locations location,
                               int damage)
@@ -727,15 +767,13 @@ int tbot_resolve_naval_battle(struct game_state *game, enum locations location,
         dice = game->t_frigates * FRIGATE_DICE +
             game->t_damaged_frigates * FRIGATE_DICE +
             game->t_corsairs_tripoli;
-        if ((game->year == 1805 && game->season != WINTER) ||
-            game->year == 1806 || game->victory_or_death) {
-            if (tbot_check_play_battle_card(game, &the_guns_of_tripoli)) {
-                dice += 12;
-            }
+        if (tbot_guns_of_tripoli_ready(game)) {
+            tbot_check_play_battle_card(game, &the_guns_of_tripoli);
+            dice += 12;
         }
     }
 
-    hits = rolld6s(dice, 6);
+    hits = rolld6s(game, dice, 6);
 
     apply_damage(game, location, NAVAL_BATTLE, damage);
     return hits;
@@ -747,7 +785,7 @@ int tbot_resolve_ground_combat(struct game_state *game, enum locations location,
     int hits = 0;
     int dice = game->t_infantry[trip_infantry_idx(location)];
 
-    hits = rolld6s(dice, 6);
+    hits = rolld6s(game, dice, 6);
 
     apply_damage(game, location, GROUND_BATTLE, damage);
     return hits;
@@ -758,18 +796,20 @@ static inline bool five_corsair_check(struct game_state *game)
     return game->t_corsairs_tripoli >= 5;
 }
 
-static bool check_add_card_to_event_line(struct game_state *game,
-                                         struct card *card)
+/* playable is the card's playable() in the position it was drawn in */
+static bool check_add_card_to_event_line(struct game_state *game, int id,
+                                         bool playable)
 {
+    struct card *card = tbot_cards[id];
     int i;
 
-    if (!card->playable(game) &&
+    if (!playable &&
         (card == &storms || card == &second_storms ||
          card == &philly_runs_aground || card == &tripoli_acquires_corsairs)) {
         tbot_log_append(game, "T-Bot adds [%s] to the event line\n", card->name);
         for (i = TBOT_EVENT_ADD_IDX; i < TBOT_EVENT_MAX; i++) {
-            if (tbot_event_line[i] == NULL) {
-                tbot_event_line[i] = card;
+            if (game->tbot_event_line[i] == CARD_NONE) {
+                game_set(game, game->tbot_event_line[i], id);
                 return true;
             }
         }
@@ -781,28 +821,29 @@ static bool check_add_card_to_event_line(struct game_state *game,
 
 static bool tbot_draw_play_card(struct game_state *game)
 {
-    int card_idx;
+    int id;
     struct card *card;
+    bool playable;
 
 draw_new_card:
-    if (tbot_deck_size == 0) {
+    if (game->tbot_deck == 0) {
         return false;
     }
 
-    card_idx = rand() % tbot_deck_size;
-    card = tbot_deck[card_idx];
-
     /* tbot cards go away forever even if unplayed */
-    tbot_deck[card_idx] = tbot_deck[tbot_deck_size - 1];
-    tbot_deck[--tbot_deck_size] = NULL;
+    id = mask_nth(game->tbot_deck,
+                  rng_range(&game->rng, mask_count(game->tbot_deck)));
+    game_set(game, game->tbot_deck, game->tbot_deck & ~(1u << id));
+    card = tbot_cards[id];
 
     assert(card && card->playable && card->play);
 
-    if (check_add_card_to_event_line(game, card)) {
+    playable = card->playable(game);
+    if (check_add_card_to_event_line(game, id, playable)) {
         goto draw_new_card;
     }
 
-    if (card->playable(game)) {
+    if (playable) {
         tbot_log_append(game, "T-Bot drew and played [%s]\n", card->name);
         card->play(game);
         return true;
@@ -818,14 +859,17 @@ static bool tbot_process_event_line(struct game_state *game)
     int i;
     struct card *card;
 
-    for (i = 0; i < array_size(tbot_event_line); i++) {
-        card = tbot_event_line[i];
-        assert(!card || (card->play && card->playable));
-        if (card && card->playable(game)) {
+    for (i = 0; i < TBOT_EVENT_MAX; i++) {
+        if (game->tbot_event_line[i] == CARD_NONE) {
+            continue;
+        }
+        card = tbot_cards[game->tbot_event_line[i]];
+        assert(card->play && card->playable);
+        if (card->playable(game)) {
             tbot_log_append(game, "T-Bot plays [%s] from the event line\n",
                             card->name);
             card->play(game);
-            tbot_event_line[i] = NULL;
+            game_set(game, game->tbot_event_line[i], CARD_NONE);
             return true;
         }
     }
@@ -840,11 +884,11 @@ static void pirate_raid(struct game_state *game, enum locations location)
     bool intercepted = game_handle_intercept(game, location);
     int card_idx;
 
-    if (intercepted && (game->year >= 1805 &&
-                        tbot_check_play_battle_card(game, &books_overboard))) {
-        card_idx = rand() % game->hand_size;
+    if (intercepted && game->year >= 1805 && game->us_hand != 0 &&
+        tbot_check_play_battle_card(game, &books_overboard)) {
+        card_idx = rng_range(&game->rng, hand_size(game));
         tbot_log_append(game, "T-Bot discards [%s] from US Hand\n",
-                        game->us_hand[card_idx]->name);
+                        hand_card(game, card_idx)->name);
         discard_from_hand(game, card_idx);
     }
 
@@ -855,15 +899,15 @@ static void pirate_raid(struct game_state *game, enum locations location)
         raid_count += 3;
     }
 
-    successes = rolld6s(raid_count, 5);
-    game->pirated_gold += successes;
+    successes = rolld6s(game, raid_count, 5);
+    game_add(game, game->pirated_gold, successes);
 
     tbot_log_append(game, "T-Bot raids from %s and pirates %d gold\n",
                     location_str(location), successes);
 
     if (successes > 0 &&
         tbot_check_play_battle_card(game, &merchant_ship_converted)) {
-        game->t_corsairs_tripoli++;
+        game_add(game, game->t_corsairs_tripoli, 1);
     }
 }
 
@@ -915,12 +959,12 @@ static void raid_or_build(struct game_state *game)
 
     if (max_score == -1) {
         tbot_log_append(game, "T-Bot builds a corsair in Tripoli\n");
-        game->t_corsairs_tripoli++;
+        game_add(game, game->t_corsairs_tripoli, 1);
         return;
     }
 
     assert(score_count > 0);
-    score_count = rand() % score_count + 1;
+    score_count = rng_range(&game->rng, score_count) + 1;
 
     for (i = 0; i <= TRIP_ALLIES; i++) {
         if (scores[i] == max_score) {
@@ -942,8 +986,23 @@ static void raid_or_build(struct game_state *game)
 
 static inline void tbot_reset_log(struct game_state *game)
 {
-    game->log_ptr = game->tbot_log;
-    game->log_ptr[0] = 0;
+    if (game->log != NULL) {
+        game->log->ptr = game->log->text;
+        game->log->ptr[0] = 0;
+    }
+}
+
+void tbot_init(struct game_state *game)
+{
+    int i;
+
+    game->tbot_deck = (1u << TBOT_DECK_SIZE) - 1;
+    game->tbot_battle_cards = (1u << array_size(tbot_battle_cards)) - 1;
+    for (i = 0; i < TBOT_EVENT_MAX; i++) {
+        game->tbot_event_line[i] = (i < TBOT_EVENT_ADD_IDX) ?
+            TBOT_EVENT_START + i : CARD_NONE;
+    }
+    tbot_reset_log(game);
 }
 
 void tbot_do_turn(struct game_state *game)
@@ -977,7 +1036,7 @@ void tbot_plays_mercenaries_desert(struct game_state *game)
     }
 
     dice = game->arab_infantry[idx];
-    remove = rolld6s(dice, 6);
+    remove = rolld6s(game, dice, 6);
 
-    game->arab_infantry[idx] -= remove;
+    game_sub(game, game->arab_infantry[idx], remove);
 }
@@ -4,10 +4,16 @@
 #include "cards.h"
 #include "game.h"
 
+/* T-Bot battle cards the US side needs to plan around */
+extern struct card the_guns_of_tripoli;
+
 int tbot_resolve_naval_battle(struct game_state *game, enum locations location,
                               int damage);
 int tbot_resolve_ground_combat(struct game_state *game, enum locations location,
                                int damage);
+bool tbot_holds_battle_card(struct game_state *game, struct card *card);
+bool tbot_guns_of_tripoli_ready(struct game_state *game);
+void tbot_init(struct game_state *game);
 void tbot_do_turn(struct game_state *game);
 bool tbot_plays_mercenaries_desert(struct game_state *game);
 
@@ -0,0 +1,238 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(__MINGW32__)
+#include <sys/mman.h>
+#endif /* !defined(__MINGW32__) */
+
+#include "tt.h"
+
+/* Four entries fill a cache line */
+#define TT_BUCKET_ENTRIES (4)
+
+/* Packing of an entry's data word */
+#define TT_SCORE_BITS (32)
+#define TT_VISITS_BITS (24)
+#define TT_VISITS_SHIFT (TT_SCORE_BITS)
+#define TT_DEPTH_SHIFT (TT_SCORE_BITS + TT_VISITS_BITS)
+#define TT_MAX_VISITS ((1ul << TT_VISITS_BITS) - 1)
+#define TT_MAX_SCORE ((1ul << TT_SCORE_BITS) - 1)
+#define TT_MAX_DEPTH (0xff)
+
+/* The key is stored XORed with the data. Threads read and write entries
+ * without locks, so an entry torn by two writers no longer verifies and is
+ * treated as some other position. A bad read costs a miss, never wrong
+ * statistics for the wrong position */
+struct tt_entry {
+    atomic_uint_least64_t check;
+    atomic_uint_least64_t data;
+};
+
+struct tt_bucket {
+    struct tt_entry entries[TT_BUCKET_ENTRIES];
+} __attribute__((aligned(64)));
+
+struct tt {
+    struct tt_bucket *buckets;
+    size_t num_buckets;
+    size_t bytes;
+    bool mapped;
+    atomic_ulong hits;
+    atomic_ulong misses;
+    atomic_ulong collisions;
+};
+
+static uint64_t pack(unsigned long visits, unsigned long score, int depth)
+{
+    /* Halving both keeps the average once either fills up */
+    while (visits > TT_MAX_VISITS || score > TT_MAX_SCORE) {
+        visits /= 2;
+        score /= 2;
+    }
+    if (depth > TT_MAX_DEPTH) {
+        depth = TT_MAX_DEPTH;
+    }
+
+    return (uint64_t)depth << TT_DEPTH_SHIFT |
+        (uint64_t)visits << TT_VISITS_SHIFT | score;
+}
+
+static void unpack(uint64_t data, struct tt_value *value)
+{
+    value->visits = (data >> TT_VISITS_SHIFT) & TT_MAX_VISITS;
+    value->score = data & TT_MAX_SCORE;
+    value->depth = data >> TT_DEPTH_SHIFT;
+}
+
+/* Shallow, well visited positions are the ones worth keeping */
+static unsigned long worth(uint64_t data)
+{
+    struct tt_value value;
+
+    unpack(data, &value);
+    return value.visits * 16 / (value.depth + 1);
+}
+
+static struct tt_bucket *bucket_for(struct tt *tt, uint64_t key)
+{
+    return &tt->buckets[key & (tt->num_buckets - 1)];
+}
+
+/* Allocated once up front, rounded down to a power of two buckets. Backed by
+ * huge pages where the system allows, NULL if there's no memory */
+struct tt *tt_new(size_t megabytes)
+{
+    struct tt *tt = calloc(1, sizeof(*tt));
+    size_t num_buckets = 1;
+
+    if (tt == NULL) {
+        return NULL;
+    }
+
+    while (num_buckets * 2 * sizeof(struct tt_bucket) <=
+           megabytes * 1024 * 1024) {
+        num_buckets *= 2;
+    }
+    tt->num_buckets = num_buckets;
+    tt->bytes = num_buckets * sizeof(struct tt_bucket);
+
+#if !defined(__MINGW32__)
+    tt->buckets = mmap(NULL, tt->bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (tt->buckets == MAP_FAILED) {
+        tt->buckets = NULL;
+    } else {
+        tt->mapped = true;
+#ifdef MADV_HUGEPAGE
+        madvise(tt->buckets, tt->bytes, MADV_HUGEPAGE);
+#endif /* MADV_HUGEPAGE */
+    }
+#endif /* !defined(__MINGW32__) */
+
+    if (tt->buckets == NULL) {
+        tt->buckets = aligned_alloc(sizeof(struct tt_bucket), tt->bytes);
+        if (tt->buckets == NULL) {
+            free(tt);
+            return NULL;
+        }
+        memset(tt->buckets, 0, tt->bytes);
+    }
+
+    return tt;
+}
+
+void tt_free(struct tt *tt)
+{
+    if (tt == NULL) {
+        return;
+    }
+
+#if !defined(__MINGW32__)
+    if (tt->mapped) {
+        munmap(tt->buckets, tt->bytes);
+    } else {
+        free(tt->buckets);
+    }
+#else
+    free(tt->buckets);
+#endif /* !defined(__MINGW32__) */
+    free(tt);
+}
+
+/* Forgets every position and zeroes the counters, nothing may be using the
+ * table */
+void tt_clear(struct tt *tt)
+{
+    memset(tt->buckets, 0, tt->bytes);
+    atomic_store(&tt->hits, 0);
+    atomic_store(&tt->misses, 0);
+    atomic_store(&tt->collisions, 0);
+}
+
+bool tt_probe(struct tt *tt, uint64_t key, struct tt_value *value,
+              struct tt_counters *counters)
+{
+    struct tt_bucket *bucket = bucket_for(tt, key);
+    struct tt_entry *entry;
+    uint64_t data;
+    int i;
+
+    for (i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        entry = &bucket->entries[i];
+        data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+        if (data != 0 &&
+            (atomic_load_explicit(&entry->check, memory_order_relaxed) ^
+             data) == key) {
+            unpack(data, value);
+            counters->hits++;
+            return true;
+        }
+    }
+
+    counters->misses++;
+    return false;
+}
+
+/* Adds playouts to the position's statistics. A new position takes an empty
+ * entry or the least worth keeping in its bucket */
+void tt_add(struct tt *tt, uint64_t key, int depth, unsigned long visits,
+            unsigned long score, struct tt_counters *counters)
+{
+    struct tt_bucket *bucket = bucket_for(tt, key);
+    struct tt_entry *entry;
+    struct tt_entry *victim = NULL;
+    unsigned long victim_worth = ~0ul;
+    struct tt_value value;
+    uint64_t data;
+    int i;
+
+    for (i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        entry = &bucket->entries[i];
+        data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+
+        if (data != 0 &&
+            (atomic_load_explicit(&entry->check, memory_order_relaxed) ^
+             data) == key) {
+            unpack(data, &value);
+            data = pack(value.visits + visits, value.score + score,
+                        (depth < value.depth) ? depth : value.depth);
+            atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+            atomic_store_explicit(&entry->check, key ^ data,
+                                  memory_order_relaxed);
+            return;
+        }
+
+        if (data == 0) {
+            if (victim_worth != 0) {
+                victim = entry;
+                victim_worth = 0;
+            }
+        } else if (worth(data) < victim_worth) {
+            victim = entry;
+            victim_worth = worth(data);
+        }
+    }
+
+    if (atomic_load_explicit(&victim->data, memory_order_relaxed) != 0) {
+        counters->collisions++;
+    }
+
+    data = pack(visits, score, depth);
+    atomic_store_explicit(&victim->data, data, memory_order_relaxed);
+    atomic_store_explicit(&victim->check, key ^ data, memory_order_relaxed);
+}
+
+/* Threads count into their own counters and hand them over when done */
+void tt_add_counters(struct tt *tt, const struct tt_counters *counters)
+{
+    atomic_fetch_add(&tt->hits, counters->hits);
+    atomic_fetch_add(&tt->misses, counters->misses);
+    atomic_fetch_add(&tt->collisions, counters->collisions);
+}
+
+void tt_get_counters(struct tt *tt, struct tt_counters *counters)
+{
+    counters->hits = atomic_load(&tt->hits);
+    counters->misses = atomic_load(&tt->misses);
+    counters->collisions = atomic_load(&tt->collisions);
+}
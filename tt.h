@@ -0,0 +1,38 @@
+#ifndef TT_H
+#define TT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Scores are stored in 1/TT_SCORE_SCALE of a playout */
+#define TT_SCORE_SCALE (256)
+
+/* Playout statistics for a position keyed by game->hash */
+struct tt_value {
+    unsigned long visits;
+    unsigned long score;
+    /* Turns below the search root when last stored */
+    int depth;
+};
+
+struct tt_counters {
+    unsigned long hits;
+    unsigned long misses;
+    /* Stores that had to push out a different position */
+    unsigned long collisions;
+};
+
+struct tt;
+
+struct tt *tt_new(size_t megabytes);
+void tt_free(struct tt *tt);
+void tt_clear(struct tt *tt);
+bool tt_probe(struct tt *tt, uint64_t key, struct tt_value *value,
+              struct tt_counters *counters);
+void tt_add(struct tt *tt, uint64_t key, int depth, unsigned long visits,
+            unsigned long score, struct tt_counters *counters);
+void tt_add_counters(struct tt *tt, const struct tt_counters *counters);
+void tt_get_counters(struct tt *tt, struct tt_counters *counters);
+
+#endif /* TT_H */